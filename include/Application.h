@@ -29,8 +29,10 @@ public:
 	void update(float deltaTime);
 
 	const std::vector<std::string>& argvObjPaths() const;
+	std::string nextArgvObjPath() const;
 	bool hasPendingObjPath() const;
 	std::string consumePendingObjPath();
+	int consumeGroupSteps();
 
 	void attachToWindow(GLFWwindow* window);
 
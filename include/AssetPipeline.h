@@ -0,0 +1,201 @@
+#ifndef ASSET_PIPELINE_H
+# define ASSET_PIPELINE_H
+
+# include <glad/glad.h>
+
+# include <atomic>
+# include <condition_variable>
+# include <cstddef>
+# include <cstdint>
+# include <deque>
+# include <memory>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <unordered_map>
+# include <vector>
+
+# include "Mesh.h"
+# include "OBJParser.h"
+# include "SpscQueue.h"
+
+// Modele entierement envoye au GPU, pret a dessiner
+struct GpuModel
+{
+	std::string path;
+	std::unique_ptr<Mesh> mesh;
+	std::vector<Submesh> submeshes;
+	std::vector<MeshGroup> groups;
+	std::unordered_map<std::string, MTLMaterial> materials; // sans pixels (deja envoyes)
+	std::unordered_map<std::string, GLuint> textures;       // par fichier map_Kd, 0 si illisible
+	math::Vec3 boundsMin{0.0f, 0.0f, 0.0f};
+	math::Vec3 boundsMax{0.0f, 0.0f, 0.0f};
+	bool hasUVs{false};
+	std::size_t gpuBytes{0}; // buffers et textures (mipmaps comprises), estime
+
+	// Rend les objets GL (thread GL)
+	void release();
+};
+
+// Modele lu et decode, pret a envoyer au GPU : ce que le thread GL peut garder
+// pour renvoyer le modele plus tard sans le relire (voir ModelCache)
+struct DecodedModel
+{
+	MeshData geometry;
+	std::unordered_map<std::string, MTLMaterial> materials; // pixels compris
+	math::Vec3 boundsMin{0.0f, 0.0f, 0.0f};
+	math::Vec3 boundsMax{0.0f, 0.0f, 0.0f};
+	bool hasUVs{false};
+
+	// Octets occupes en memoire (geometrie et pixels)
+	std::size_t byteSize() const;
+};
+
+// Chargement de modeles en arriere-plan, par etapes :
+//   lecture + analyse + deduplication (OBJParser::loadFromFile, threads "load",
+//   plusieurs fichiers en parallele)
+//   -> decodage des textures (OBJParser::decodeTextures, thread "texture", qui
+//      les range dans le cache de textures, voir MeshCache)
+//   -> envoi GPU (pump(), sur le thread GL, borne en octets par image).
+// Les etapes se passent les travaux par des SpscQueue bornees : un thread
+// producteur et un consommateur par file, donc une paire de files par thread
+// "load". Un thread qui n'a rien a faire (file d'entree vide ou file de sortie
+// pleine) dort sur son WakeSignal.
+//
+// Chaque demande vise une case (slot) : une nouvelle demande pour la meme case
+// rend les precedentes obsoletes, abandonnees a la prochaine frontiere d'etape
+// (ou en plein envoi GPU). Le modele affiche reste celui de l'appelant tant que
+// pump() n'en a pas rendu un nouveau.
+class AssetPipeline
+{
+	public:
+		struct Settings
+		{
+			bool useCache{true};
+			bool generateNormals{true};
+			// Threads "load" ; 0 : un par coeur, sans depasser le nombre de cases
+			std::size_t loadThreads{0};
+		};
+
+		// Fin d'un chargement, rendue par pump()
+		struct Completion
+		{
+			std::size_t slot{0};
+			std::string path;
+			bool ok{false};
+			GpuModel model; // valide si ok, sauf pour un prefetch
+			std::shared_ptr<DecodedModel> decoded; // si ok, et garde (setKeepDecodedBytes) ou prefetch
+			bool prefetched{false}; // demande par prefetch() : rien n'a ete envoye
+		};
+
+		AssetPipeline(std::size_t slotCount, const Settings& settings);
+		~AssetPipeline();
+
+		// Thread GL. Demande le chargement de path dans slot
+		void request(std::size_t slot, const std::string& path);
+		// Thread GL. Comme request(), mais envoie directement un modele deja
+		// decode (garde par l'appelant, qui le partage : il n'est pas modifie)
+		void upload(std::size_t slot, const std::string& path, const std::shared_ptr<DecodedModel>& decoded);
+		// Thread GL. Comme request(), mais s'arrete apres le decodage des
+		// textures : pump() rend le DecodedModel sans rien envoyer au GPU
+		void prefetch(std::size_t slot, const std::string& path);
+		// Thread GL : avance l'envoi GPU en decomptant les octets envoyes de
+		// budgetBytes (au moins un element par appel). Retourne true et remplit
+		// done quand un chargement se termine, avec succes ou non ; appele en
+		// boucle tant qu'il reste du budget, une image rend plusieurs chargements
+		// sans depasser son budget.
+		bool pump(std::size_t& budgetBytes, Completion& done);
+		// Un chargement est demande pour slot et pas encore rendu par pump()
+		bool isLoading(std::size_t slot) const;
+		// Thread GL. Un modele dont la copie decodee tient dans bytes la garde
+		// apres l'envoi et la rend dans Completion ; sinon vertices et index sont
+		// liberes des qu'ils sont sur le GPU. Lu au debut de chaque envoi ; 0 (par
+		// defaut) : aucune copie gardee
+		void setKeepDecodedBytes(std::size_t bytes) { m_keepDecodedBytes = bytes; }
+
+	private:
+		AssetPipeline(const AssetPipeline&);
+		AssetPipeline& operator=(const AssetPipeline&);
+
+		// Reveil d'un thread d'etape ; un signal emis avant wait() n'est pas perdu
+		class WakeSignal
+		{
+			public:
+				WakeSignal() : m_raised(false) {}
+				void notify();
+				void wait();
+
+			private:
+				std::mutex m_mutex;
+				std::condition_variable m_cond;
+				bool m_raised;
+		};
+
+		struct Job
+		{
+			std::size_t slot{0};
+			std::uint64_t generation{0};
+			std::string path;
+			std::unique_ptr<OBJParser> parser;     // jusqu'au decodage des textures
+			std::shared_ptr<DecodedModel> decoded; // geometrie apres l'analyse, materiaux apres les textures
+			bool shared{false};                    // decoded vient de upload() : ne pas y toucher
+			bool prefetch{false};                  // rendu par pump() sans envoi GPU
+			bool ok{false};
+		};
+
+		// Envoi GPU en cours, repris d'une image a l'autre
+		struct Upload
+		{
+			Job job;
+			GpuModel model;
+			std::size_t verticesSent{0};
+			std::size_t indicesSent{0};
+			std::vector<const MTLMaterial*> textures; // a envoyer, un par map_Kd
+			std::size_t texturesSent{0};
+			bool keepDecoded{false}; // copie decodee rendue dans Completion
+			bool active{false};
+		};
+
+		// Thread "load" et ses deux files
+		struct Loader
+		{
+			Loader(std::size_t requestCapacity, std::size_t parsedCapacity)
+				: requests(requestCapacity), parsed(parsedCapacity) {}
+
+			SpscQueue<Job> requests; // GL -> load
+			SpscQueue<Job> parsed;   // load -> texture
+			WakeSignal wake;
+			std::thread thread;
+		};
+
+		bool isCurrent(const Job& job) const;
+		// Thread GL : confie job au premier thread "load" qui a de la place, en
+		// tournant ; false si toutes les files de demandes sont pleines
+		bool dispatch(Job& job);
+		void loadStage(Loader& loader);
+		void textureStage();
+		// Pousse job dans out, en dormant sur self tant que out est pleine, puis
+		// reveille consumer (s'il y en a un) ; false si le pipeline s'arrete entre-temps
+		bool forward(Job& job, SpscQueue<Job>& out, WakeSignal& self, WakeSignal* consumer);
+		void startUpload(Job& job);
+		bool continueUpload(std::size_t& budget);
+
+	private:
+		const Settings m_settings;
+		std::vector<std::unique_ptr<std::atomic<std::uint64_t> > > m_generations;
+		std::vector<std::uint64_t> m_delivered; // thread GL : derniere generation rendue par slot
+		std::atomic<bool> m_stop;
+
+		std::vector<std::unique_ptr<Loader> > m_loaders;
+		std::size_t m_nextLoader;  // thread GL : prochain thread "load" essaye
+		SpscQueue<Job> m_decoded;  // texture -> GL
+		std::deque<Job> m_backlog; // thread GL : demandes en attente de place chez un thread "load"
+		std::deque<Job> m_ready;   // thread GL : modeles deja decodes passes a upload()
+		WakeSignal m_textureWake;
+		Upload m_upload;
+		std::size_t m_keepDecodedBytes; // thread GL
+
+		std::thread m_textureThread;
+};
+
+#endif
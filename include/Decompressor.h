@@ -0,0 +1,59 @@
+#ifndef DECOMPRESSOR_H
+# define DECOMPRESSOR_H
+
+# include <cstddef>
+# include <string>
+
+# include "MappedFile.h"
+
+// Lecture en flux d'un fichier compresse (gzip ou zstd, reconnu a ses premiers
+// octets). Le fichier compresse est projete en memoire (MappedFile) et decompresse
+// morceau par morceau dans le tampon de l'appelant, sans fichier intermediaire.
+//
+// zlib et libzstd sont optionnelles : SCOP_HAVE_ZLIB / SCOP_HAVE_ZSTD sont definis
+// par le Makefile quand elles sont installees. Sans elles, le format est reconnu
+// mais open() echoue avec un message.
+class Decompressor
+{
+	public:
+		enum Format
+		{
+			FORMAT_NONE,
+			FORMAT_GZIP,
+			FORMAT_ZSTD
+		};
+
+		Decompressor();
+		~Decompressor();
+
+		// Format d'apres les octets magiques de [data, data + size)
+		static Format detect(const char* data, std::size_t size);
+		// Format d'un fichier d'apres ses premiers octets (FORMAT_NONE s'il est illisible)
+		static Format detectFile(const std::string& path);
+
+		bool open(const std::string& path);
+		void close();
+
+		// Decompresse au plus capacity octets dans out. Retourne le nombre d'octets
+		// ecrits : 0 a la fin du flux, ou en cas d'erreur (voir failed()).
+		std::size_t read(char* out, std::size_t capacity);
+		bool failed() const { return m_failed; }
+		Format format() const { return m_format; }
+
+	private:
+		Decompressor(const Decompressor&);
+		Decompressor& operator=(const Decompressor&);
+
+		std::size_t readGzip(char* out, std::size_t capacity);
+		std::size_t readZstd(char* out, std::size_t capacity);
+
+	private:
+		MappedFile m_file;
+		Format m_format;
+		void* m_state;         // z_stream* ou ZSTD_DStream* selon m_format
+		std::size_t m_consumed; // octets compresses deja donnes au decodeur
+		bool m_finished;
+		bool m_failed;
+};
+
+#endif
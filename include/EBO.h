@@ -10,6 +10,8 @@ class EBO
         GLuint ID;
         EBO(GLuint* indices, GLsizeiptr size);
 
+        // Remplace size octets a partir de offset (le buffer doit etre lie)
+        void Update(GLintptr offset, const void* data, GLsizeiptr size);
         void Bind();
         void Unbind();
         void Delete();
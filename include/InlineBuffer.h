@@ -0,0 +1,68 @@
+#ifndef INLINE_BUFFER_H
+# define INLINE_BUFFER_H
+
+# include <cstddef>
+
+// Tableau dynamique dont les N premiers elements sont stockes dans l'objet :
+// aucune allocation tant que la taille reste <= N (ex: coins d'une face OBJ),
+// passage au tas seulement au-dela (tres grands n-gones). Pour types simples.
+template <typename T, std::size_t N>
+class InlineBuffer
+{
+	public:
+		InlineBuffer()
+			: m_data(m_inline)
+			, m_size(0)
+			, m_capacity(N)
+		{
+		}
+
+		~InlineBuffer()
+		{
+			if (m_data != m_inline)
+				delete[] m_data;
+		}
+
+		void push_back(const T& value)
+		{
+			if (m_size == m_capacity)
+				spill();
+			m_data[m_size++] = value;
+		}
+
+		void clear() { m_size = 0; }
+		std::size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+
+		T& operator[](std::size_t i) { return m_data[i]; }
+		const T& operator[](std::size_t i) const { return m_data[i]; }
+		T* data() { return m_data; }
+		const T* data() const { return m_data; }
+		const T* begin() const { return m_data; }
+		const T* end() const { return m_data + m_size; }
+
+	private:
+		InlineBuffer(const InlineBuffer&);
+		InlineBuffer& operator=(const InlineBuffer&);
+
+		// Double la capacite ; le bloc du tas est garde pour les faces suivantes
+		void spill()
+		{
+			const std::size_t newCapacity = m_capacity * 2;
+			T* grown = new T[newCapacity];
+			for (std::size_t i = 0; i < m_size; ++i)
+				grown[i] = m_data[i];
+			if (m_data != m_inline)
+				delete[] m_data;
+			m_data = grown;
+			m_capacity = newCapacity;
+		}
+
+	private:
+		T m_inline[N];
+		T* m_data;
+		std::size_t m_size;
+		std::size_t m_capacity;
+};
+
+#endif
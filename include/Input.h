@@ -14,12 +14,17 @@ class Input
 
 		void setObjPathsFromArgv(int argc, char** argv);
 		const std::vector<std::string>& argvObjPaths() const;
+		// Chemin que le prochain TAB ouvrira, "" s'il ouvrira le selecteur
+		std::string nextArgvObjPath() const;
 
 		bool keyDown(int glfwKey) const;
 
 		bool hasPendingObjPath() const;
 		std::string consumePendingObjPath();
 
+		// Appuis sur G depuis le dernier appel (groupe suivant affiche seul)
+		int consumeGroupSteps();
+
 		void onKey(GLFWwindow* window, int key, int action);
 
 	private:
@@ -35,6 +40,7 @@ class Input
 		std::string m_pendingObjPath;
 		std::vector<std::string> m_argvObjPaths;
 		std::size_t m_nextArgvIndex;
+		int m_groupSteps;
 };
 
 #endif
@@ -0,0 +1,33 @@
+#ifndef MAPPED_FILE_H
+# define MAPPED_FILE_H
+
+# include <cstddef>
+# include <string>
+
+// Projection en lecture seule d'un fichier (mmap), parcourue comme une plage d'octets.
+// La plage [begin, end) n'est PAS terminee par '\0'.
+class MappedFile
+{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool open(const std::string& path);
+		void close();
+
+		bool isOpen() const;
+		const char* begin() const;
+		const char* end() const;
+		std::size_t size() const;
+
+	private:
+		MappedFile(const MappedFile&);
+		MappedFile& operator=(const MappedFile&);
+
+	private:
+		void* m_data;
+		std::size_t m_size;
+		bool m_open;
+};
+
+#endif
@@ -171,6 +171,29 @@ namespace math
 		return r;
 	}
 
+	// Boite [bmin, bmax] au moins en partie dans le volume de vue de viewProj
+	// (plans extraits des lignes de la matrice, methode Gribb-Hartmann)
+	inline bool aabbInFrustum(const Mat4& viewProj, const Vec3& bmin, const Vec3& bmax)
+	{
+		const float* m = viewProj.m.data();
+		for (int i = 0; i < 6; ++i)
+		{
+			const int row = i / 2;
+			const float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+			const float a = m[3] + sign * m[row];
+			const float b = m[7] + sign * m[4 + row];
+			const float c = m[11] + sign * m[8 + row];
+			const float d = m[15] + sign * m[12 + row];
+			// Sommet de la boite le plus loin du cote interieur du plan
+			const float x = (a >= 0.0f) ? bmax.x : bmin.x;
+			const float y = (b >= 0.0f) ? bmax.y : bmin.y;
+			const float z = (c >= 0.0f) ? bmax.z : bmin.z;
+			if (a * x + b * y + c * z + d < 0.0f)
+				return false;
+		}
+		return true;
+	}
+
 	inline Mat4 lookAt(const Vec3& eye, const Vec3& center, const Vec3& upIn)
 	{
 		const Vec3 f = normalize(sub(center, eye));
@@ -16,10 +16,18 @@ class Mesh
 {
 	public:
 		Mesh(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices);
+		// Buffers alloues sans contenu, remplis ensuite par morceaux (envoi etale sur
+		// plusieurs images, voir AssetPipeline)
+		Mesh(std::size_t vertexCount, std::size_t indexCount);
+
+		void UploadVertices(std::size_t first, const Vertex* vertices, std::size_t count);
+		void UploadIndices(std::size_t first, const std::uint32_t* indices, std::size_t count);
 
 		void Bind();
 		void Unbind();
 		void Draw();
+		// Dessine plusieurs plages en un appel (glMultiDrawElements)
+		void DrawRanges(const GLsizei* firstIndices, const GLsizei* counts, GLsizei rangeCount);
 		void Delete();
 
 		GLsizei getIndexCount() const;
@@ -32,6 +40,7 @@ class Mesh
 		//materials
 		std::unordered_map<std::string, Material> m_materials;
 		GLsizei m_indexCount;
+		std::vector<const void*> m_rangeOffsets;
 		OBJParser m_parser;
 };
 
@@ -0,0 +1,53 @@
+#ifndef MESH_CACHE_H
+# define MESH_CACHE_H
+
+# include <cstddef>
+# include <cstdint>
+# include <string>
+
+class OBJParser;
+
+// Cache binaire (.scopbin) du resultat d'un chargement OBJ : vertices, index,
+// plages par materiau et par groupe, bornes, table des materiaux, materiaux
+// cites par usemtl et pixels des textures deja decodes.
+//
+// Le fichier est ecrit a cote de la source ("modele.obj.scopbin") puis projete
+// en memoire (mmap) aux chargements suivants. Il n'est utilise que si la source
+// a le meme chemin, la meme taille, la meme date de modification et le meme
+// hache de contenu, et si chaque .mtl/.ppm lu a l'epoque est inchange. Le reglage
+// de generation des normales fait partie de la cle.
+//
+// Les textures decodees apres l'ecriture du cache (decodage differe, voir
+// AssetPipeline) vont dans un second fichier, "modele.obj.scoptex" : leurs pixels
+// ne dependent que du .ppm, chaque entree est valide tant que celui-ci a la meme
+// taille et la meme date.
+class MeshCache
+{
+	public:
+		// Version du format : a incrementer a chaque changement de disposition
+		static const std::uint32_t kVersion = 7;
+
+		static std::string cachePathFor(const std::string& sourcePath);
+
+		// Remplit parser depuis le cache si celui-ci est valide pour sourcePath
+		static bool load(const std::string& sourcePath, OBJParser& parser);
+		// Ecrit le cache de sourcePath a partir d'un parser deja charge
+		static bool store(const std::string& sourcePath, const OBJParser& parser);
+
+		static std::string textureCachePathFor(const std::string& sourcePath);
+		// Complete les materiaux utilises sans pixels depuis le cache de textures
+		static bool loadTextures(const std::string& sourcePath, OBJParser& parser);
+		// Ecrit les textures decodees des materiaux de parser
+		static bool storeTextures(const std::string& sourcePath, const OBJParser& parser);
+
+		// Hache 64 bits rapide (8 octets par pas) du contenu d'un fichier
+		static std::uint64_t hashBytes(const char* data, std::size_t size);
+
+		// Taille et date de modification (ns) ; false si le fichier n'existe pas
+		static bool statFile(const std::string& path, std::uint64_t& size, std::int64_t& mtimeNs);
+
+	private:
+		static void discardCachedData(OBJParser& parser);
+};
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef MODEL_CACHE_H
+# define MODEL_CACHE_H
+
+# include <cstddef>
+# include <cstdint>
+# include <list>
+# include <memory>
+# include <string>
+# include <unordered_map>
+
+# include "AssetPipeline.h"
+
+// Modeles deja charges pendant la session, par chemin : le modele sur le GPU
+// (buffers et textures) et le DecodedModel qui permet de le renvoyer sans relire
+// le fichier. Une entree ne sert que tant que le fichier garde la meme taille et
+// la meme date de modification.
+//
+// Chaque cote a son budget en octets. Au-dela, les entrees les moins recemment
+// utilisees perdent d'abord leur copie GPU ou CPU, puis disparaissent quand il
+// ne leur reste rien. L'entree la plus recente et le modele affiche (setPinned)
+// gardent leur copie GPU. Si le fichier du modele affiche change, sa copie GPU
+// reste dessinable (find) jusqu'a l'insertion de la nouvelle, mais ne compte
+// plus comme un hit. Thread GL uniquement.
+class ModelCache
+{
+	public:
+		struct Budgets
+		{
+			std::size_t cpuBytes{0};
+			std::size_t vramBytes{0};
+		};
+
+		struct Stats
+		{
+			std::size_t gpuHits{0};      // deja sur le GPU : rien a faire
+			std::size_t cpuHits{0};      // decode en memoire : envoi GPU seulement
+			std::size_t misses{0};       // chargement complet
+			std::size_t gpuEvictions{0};
+			std::size_t cpuEvictions{0};
+		};
+
+		explicit ModelCache(const Budgets& budgets);
+		// Rend les objets GL encore en cache
+		~ModelCache();
+
+		// Modele de path sur le GPU, NULL sinon ; dans ce cas decoded recoit la
+		// copie CPU s'il y en a une (a passer a AssetPipeline::upload). Compte un
+		// hit GPU, un hit CPU ou un miss ; l'entree devient la plus recente.
+		const GpuModel* lookup(const std::string& path, std::shared_ptr<DecodedModel>& decoded);
+		// Modele de path sur le GPU, sans rien compter ni changer l'ordre ; NULL sinon
+		const GpuModel* find(const std::string& path) const;
+		// Une copie GPU ou CPU a jour de path est en cache (sans verifier le fichier)
+		bool contains(const std::string& path) const;
+		// Range un modele qui vient d'etre envoye, a la place de l'ancien pour
+		// path ; model est vide ensuite. decoded peut etre nul, model aussi
+		// (modele prefetche : copie CPU seule)
+		void insert(const std::string& path, GpuModel& model, const std::shared_ptr<DecodedModel>& decoded);
+		// Modele affiche, jamais evince du GPU ("" : aucun)
+		void setPinned(const std::string& path);
+
+		const Stats& stats() const { return m_stats; }
+		std::size_t cpuBytes() const { return m_cpuBytes; }
+		std::size_t vramBytes() const { return m_vramBytes; }
+
+	private:
+		ModelCache(const ModelCache&);
+		ModelCache& operator=(const ModelCache&);
+
+		struct Entry
+		{
+			std::string path;
+			std::uint64_t size{0};
+			std::int64_t mtimeNs{0};
+			GpuModel gpu;                          // gpu.mesh nul une fois evince
+			std::shared_ptr<DecodedModel> decoded; // nul une fois evince
+			std::size_t decodedBytes{0};
+			// gpu vient d'une version precedente du fichier, gardee parce que c'est
+			// le modele affiche ; libere des qu'il est remplace ou n'est plus affiche
+			bool staleGpu{false};
+		};
+		typedef std::list<Entry> EntryList; // la plus recente en tete
+
+		static bool isFresh(const Entry& entry);
+		EntryList::iterator erase(EntryList::iterator it);
+		void releaseGpu(Entry& entry);
+		void releaseDecoded(Entry& entry);
+		// Evince jusqu'a repasser sous les deux budgets (ou plus rien a evincer)
+		void trim();
+
+	private:
+		const Budgets m_budgets;
+		Stats m_stats;
+		EntryList m_entries;
+		std::unordered_map<std::string, EntryList::iterator> m_index;
+		std::string m_pinned;
+		std::size_t m_cpuBytes;
+		std::size_t m_vramBytes;
+};
+
+#endif
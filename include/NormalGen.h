@@ -0,0 +1,45 @@
+#ifndef NORMAL_GEN_H
+# define NORMAL_GEN_H
+
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+struct Vertex;
+
+// Normales lissees ponderees par l'aire des triangles, pour les vertices qui
+// n'en ont pas dans le fichier.
+//
+// Le lissage suit une cle par vertex : (index de position, groupe de lissage "s"
+// cote parser). Deux vertices de meme cle recoivent la meme normale meme s'ils
+// sont distincts par ailleurs (uv differents sur une couture de texture). Une
+// face "s off" a une cle a elle et recoit donc sa normale de face.
+//
+// Trois etapes, chacune repartie sur threadCount threads :
+//   1. les vertices concernes sont ranges par position (tri par denombrement
+//      stable, sans operation atomique : paquets de positions par thread, puis
+//      chaque paquet trie par un seul thread), puis numerotes par cle ;
+//   2. liste des triangles de chaque cle (CSR), par le meme tri : chaque liste
+//      sort dans l'ordre des index ;
+//   3. pour chaque cle, somme des normales de ses triangles, normalisation, puis
+//      copie dans chacun de ses vertices. La normale d'un triangle est son
+//      produit vectoriel non normalise (sa longueur vaut deux fois l'aire, d'ou
+//      la ponderation), recalculee a chaque usage plutot que stockee ; en SSE2
+//      sauf si textscan::activeLevel() est scalaire (scop_bench --simd scalar),
+//      avec les memes operations dans le meme ordre.
+// Le resultat ne depend ni du nombre de threads ni du niveau SIMD.
+//
+// Mesure (scop_bench --normals, 1 CPU, 2M triangles) : 75 a 95 ms contre 110 a
+// 130 ms pour l'ancien tri std::sort en serie. Le gain de l'etape 3 en SSE2 se
+// perd dans le bruit : elle est limitee par les lectures de positions.
+namespace normals
+{
+	// Cle d'un vertex dont la normale est gardee telle quelle
+	const std::uint64_t kKeep = ~static_cast<std::uint64_t>(0);
+
+	// keys[i] : cle de lissage de vertices[i], ou kKeep
+	void generate(std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+		const std::vector<std::uint64_t>& keys, unsigned threadCount);
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifndef NUMBER_SCAN_H
+# define NUMBER_SCAN_H
+
+# include <cfloat>
+# include <charconv>
+# include <cmath>
+# include <cstdlib>
+# include <cstring>
+# include <system_error>
+
+// Lecture de nombres directement depuis une plage [p, end) de caracteres :
+// pas d'allocation, pas de locale, pas de '\0' requis en fin de plage.
+// Chaque fonction avance p juste apres le nombre lu en cas de succes et
+// laisse p inchange en cas d'echec.
+namespace scan
+{
+	// Flottant au format decimal (ex: "-1.5e-3", "+.25").
+	// std::from_chars arrondit correctement, comme strtof : la valeur obtenue
+	// est identique bit a bit a celle de `stream >> float`.
+	inline bool parseFloat(const char*& p, const char* end, float& out)
+	{
+		const char* first = p;
+		// from_chars refuse le '+' initial accepte par strtof
+		if (first < end && *first == '+' && first + 1 < end && *(first + 1) != '-')
+			++first;
+		float value = 0.0f;
+		const std::from_chars_result res = std::from_chars(first, end, value, std::chars_format::general);
+		if (res.ec == std::errc::result_out_of_range)
+		{
+			// Hors limites : on reproduit operator>> (strtof, puis +-FLT_MAX et
+			// echec si la valeur deborde ; sous-depassement accepte tel quel).
+			char buf[128];
+			const std::size_t n = static_cast<std::size_t>(res.ptr - p);
+			if (n >= sizeof(buf))
+				return false;
+			std::memcpy(buf, p, n);
+			buf[n] = '\0';
+			value = std::strtof(buf, NULL);
+			if (std::isinf(value))
+			{
+				out = value < 0.0f ? -FLT_MAX : FLT_MAX;
+				return false;
+			}
+		}
+		else if (res.ec != std::errc())
+			return false;
+		out = value;
+		p = res.ptr;
+		return true;
+	}
+
+	// Entier signe en base 10 (ex: "12", "-3", "+7"). Echoue en cas de debordement.
+	inline bool parseInt(const char*& p, const char* end, int& out)
+	{
+		const char* first = p;
+		if (first < end && *first == '+' && first + 1 < end && *(first + 1) != '-')
+			++first;
+		int value = 0;
+		const std::from_chars_result res = std::from_chars(first, end, value, 10);
+		if (res.ec != std::errc())
+			return false;
+		out = value;
+		p = res.ptr;
+		return true;
+	}
+
+	inline bool isBlank(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	inline const char* skipBlanks(const char* p, const char* end)
+	{
+		while (p < end && isBlank(*p))
+			++p;
+		return p;
+	}
+
+	// Saute les blancs puis lit un flottant (equivalent de `iss >> f`).
+	inline bool nextFloat(const char*& p, const char* end, float& out)
+	{
+		const char* q = skipBlanks(p, end);
+		if (!parseFloat(q, end, out))
+			return false;
+		p = q;
+		return true;
+	}
+
+	// Saute les blancs puis lit un entier (equivalent de `iss >> i`).
+	inline bool nextInt(const char*& p, const char* end, int& out)
+	{
+		const char* q = skipBlanks(p, end);
+		if (!parseInt(q, end, out))
+			return false;
+		p = q;
+		return true;
+	}
+}
+
+#endif
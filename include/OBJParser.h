@@ -4,8 +4,13 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <unordered_map>
+#include <unordered_set>
 #include "Math3D.h"
+#include "TextureDecoder.h"
+#include "VertexDedupTable.h"
 
 // struct Vec2 {
 //     float x, y;
@@ -15,16 +20,39 @@
 //     float x, y, z;
 // };
 
-struct Pixel {
-    int r, g, b;
-};
-
 struct Vertex {
     math::Vec3 position;
     math::Vec3 normal;
     math::Vec2 uv;
 };
 
+// Plage contiguë de m_indices dessinée avec un seul matériau
+struct Submesh {
+    std::string material;  // nom donné à usemtl ("" : faces lues avant tout usemtl)
+    uint32_t firstIndex{0};
+    uint32_t indexCount{0};
+    uint32_t group{0};     // index dans getGroups()
+};
+
+// Objet ou groupe ('o' / 'g') : ses sous-maillages se suivent dans m_indices
+struct MeshGroup {
+    std::string name;      // nom donné à o/g ("" : faces lues avant tout o/g)
+    uint32_t firstIndex{0};
+    uint32_t indexCount{0};
+    uint32_t firstSubmesh{0};
+    uint32_t submeshCount{0};
+    math::Vec3 boundsMin{0.0f, 0.0f, 0.0f};
+    math::Vec3 boundsMax{0.0f, 0.0f, 0.0f};
+};
+
+// Géométrie finie d'un chargement, sortie du parser par takeMeshData()
+struct MeshData {
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Submesh> submeshes;
+    std::vector<MeshGroup> groups;
+};
+
 struct MTLMaterial {
     std::string name;
     math::Vec3 Ka{0.0f, 0.0f, 0.0f};
@@ -34,21 +62,87 @@ struct MTLMaterial {
     float d{1.0f};
     int illum{0};
     std::string map_Kd;
+    std::string texturePath; // map_Kd résolu depuis le dossier du .mtl
     int textureWidth{0};
     int textureHeight{0};
-    std::vector<Pixel> textureData;
+    std::vector<unsigned char> textureData; // RGB 8 bits, 3 octets par texel, envoyé tel quel au GPU
 
 };
 
 class OBJParser {
+    friend class MeshCache;
+
 public:
+    // Façon de lire le fichier .obj (même résultat m_vertices/m_indices).
+    // Un fichier gzip ou zstd (reconnu à ses premiers octets) est toujours
+    // décompressé en flux vers le lecteur mmap, quel que soit ce réglage.
+    enum Reader {
+        READER_STREAM, // std::getline + std::istringstream par ligne
+        READER_MMAP    // projection mmap parcourue en place, sans objet par ligne
+    };
+
+    // Syntaxe des coins de face, détectée sur la première ligne "f" du fichier
+    enum FaceFormat {
+        FACE_GENERIC, // mélange ou syntaxe inattendue : analyse complète de chaque coin
+        FACE_V,       // f 1 2 3
+        FACE_V_VT,    // f 1/1 2/2 3/3
+        FACE_V_VN,    // f 1//1 2//2 3//3
+        FACE_V_VT_VN  // f 1/1/1 2/2/2 3/3/3
+    };
+
     // Charge un fichier .obj et remplit vertices + indices
     bool loadFromFile(const std::string& filepath);
+    // Ajoute les matériaux d'un fichier .mtl (appelé pour chaque mtllib). Seules
+    // les textures des matériaux déjà cités par usemtl sont décodées (en
+    // parallèle, avant le retour) ; les autres ne sont jamais lues
+    bool loadMtlFromFile(const std::string& filepath);
+
+    void setReader(Reader reader) { m_reader = reader; }
+    Reader getReader() const { return m_reader; }
+
+    // Cache binaire .scopbin à côté du fichier source (voir MeshCache)
+    void setUseCache(bool useCache) { m_useCache = useCache; }
+    bool loadedFromCache() const { return m_loadedFromCache; }
+
+    // Threads du lecteur mmap (0 = automatique selon la taille du fichier et les cœurs)
+    void setThreadCount(unsigned count) { m_threadCount = count; }
+
+    // Normales lissées calculées après la lecture pour les coins sans "vn",
+    // par groupe de lissage 's' ("s off" / "s 0" : normale de face). Désactivé par défaut.
+    void setGenerateNormals(bool enable) { m_generateNormals = enable; }
+    bool generatesNormals() const { return m_generateNormals; }
+
+    // Textures map_Kd décodées plus tard par decodeTextures() au lieu de
+    // pendant la lecture du .mtl (étape séparée d'un chargement en arrière-plan)
+    void setDeferTextureDecode(bool defer) { m_deferTextures = defer; }
+    // Décode, en parallèle, les textures des matériaux cités par usemtl qui n'ont
+    // pas encore leurs pixels, puis les range dans le cache de textures
+    void decodeTextures();
+
+    // Durées du dernier chargement (hors cache), en millisecondes
+    struct LoadStats {
+        double parseMs{0.0};   // lecture du fichier jusqu'aux vertices/index
+        double normalsMs{0.0}; // génération des normales manquantes
+        size_t positionCount{0}, normalCount{0}, uvCount{0}; // v / vn / vt lus
+        // Tas occupé au plus haut pendant le chargement, au-delà de l'état de départ
+        // (relevé à chaque étape via mallinfo2, 0 hors glibc ; tout le processus est compté)
+        size_t peakHeapBytes{0};
+    };
+    const LoadStats& getLoadStats() const { return m_loadStats; }
 
     const std::vector<Vertex>& getVertices() const { return m_vertices; }
     const std::vector<uint32_t>& getIndices() const { return m_indices; }
+    // Une plage par couple (groupe, matériau) : groupes dans l'ordre du fichier,
+    // puis matériaux triés par texture et par nom à l'intérieur d'un groupe
+    const std::vector<Submesh>& getSubmeshes() const { return m_submeshes; }
+    const std::vector<MeshGroup>& getGroups() const { return m_groups; }
+    // Déplace vertices, index, sous-maillages et groupes hors du parser, sans
+    // copie : le parser n'a plus de géométrie ensuite (matériaux et bornes restent)
+    MeshData takeMeshData();
 
     const std::unordered_map<std::string, MTLMaterial>& getMaterials() const { return m_materials; }
+    // Déplace la table des matériaux (pixels compris) hors du parser
+    std::unordered_map<std::string, MTLMaterial> takeMaterials();
     const std::string& getActiveMaterialName() const { return m_activeMaterial; }
     const MTLMaterial* getResolvedActiveMaterial() const;
     bool tryGetActiveDiffuse(math::Vec3& outKd) const;
@@ -68,9 +162,27 @@ private:
 	std::unordered_map<std::string, MTLMaterial> m_materials;
 	std::string m_activeMaterial;
 	std::string m_firstUsedMaterial;
+    // Matériaux cités par usemtl : les seuls dont la texture est lue
+    std::unordered_set<std::string> m_usedMaterials;
     math::Vec3 m_boundsMin{0.0f, 0.0f, 0.0f};
     math::Vec3 m_boundsMax{0.0f, 0.0f, 0.0f};
     bool m_hasUVs{false};
+    Reader m_reader{READER_MMAP};
+    unsigned m_threadCount{0};
+    size_t m_rejectedFaces{0};
+    bool m_useCache{false};
+    bool m_loadedFromCache{false};
+    std::string m_sourcePath; // dernier loadFromFile, clé du cache de textures
+    bool m_generateNormals{false};
+    bool m_deferTextures{false};
+    // Textures map_Kd en cours de décodage pendant le chargement (nul sinon)
+    std::unique_ptr<TextureDecoder> m_textureDecoder;
+    // mtllib du début du fichier déjà lus avant le découpage en morceaux
+    size_t m_headerMtllibs{0};
+    LoadStats m_loadStats;
+    size_t m_heapBase{0};
+    // Fichiers .mtl et textures lus pendant le chargement (invalidation du cache)
+    std::vector<std::string> m_dependencies;
 
     //PPM parser pour les textures
     static std::string directoryOf(const std::string& filepath);
@@ -78,6 +190,18 @@ private:
     // Données finales OpenGL
     std::vector<Vertex> m_vertices;
     std::vector<uint32_t> m_indices;
+    std::vector<Submesh> m_submeshes;
+    std::vector<MeshGroup> m_groups;
+    // Pendant le chargement : cases de m_groups / m_submeshes (avant tri)
+    std::unordered_map<std::string, uint32_t> m_groupSlots;
+    std::unordered_map<std::string, uint32_t> m_submeshSlots;
+
+    // Pendant le chargement, si m_generateNormals : clé de lissage de chaque vertex
+    // dont la normale est à calculer (normals::kKeep pour les autres)
+    std::vector<uint64_t> m_normalKeys;
+
+    // Déduplication des coins de face (v, vt, vn) -> index dans m_vertices, propre à chaque chargement
+    VertexDedupTable m_dedup;
 
 private:
     struct ObjIndex {
@@ -85,18 +209,99 @@ private:
         int vt;
         int vn;
 
-        bool operator==(const ObjIndex& other) const;
     };
 
-    struct ObjIndexHash {
-        size_t operator()(const ObjIndex& k) const;
+    // usemtl / mtllib / o / g / s rencontré dans un morceau, rejoué à sa place lors de la fusion
+    struct ObjEvent {
+        enum Type { USEMTL, MTLLIB, GROUP, SMOOTH };
+        Type type;
+        size_t faceIndex; // nombre de faces du morceau lues avant l'événement
+        std::pmr::string arg; // dans l'arène du morceau
+        uint32_t slot{0}; // USEMTL / GROUP : case de m_submeshes active ensuite (passe 1 de la fusion)
+        int smooth{0};    // SMOOTH : numéro du groupe de lissage, -1 pour "off" (passe 1 de la fusion)
+    };
+
+    // Morceau du fichier découpé sur une fin de ligne, lu par un thread
+    struct ObjChunk {
+        const char* begin{nullptr};
+        const char* end{nullptr};
+
+        // Passe de comptage puis somme préfixe : position globale du morceau
+        size_t positionCount{0}, normalCount{0}, uvCount{0};
+        size_t positionBase{0}, normalBase{0}, uvBase{0};
+        size_t faceCount{0}, cornerCount{0}; // lignes "f" et coins de ces lignes
+        size_t eventCount{0}, eventBytes{0}; // lignes d'événement possibles et leur texte
+        int firstFaceFormat{-1}; // FaceFormat de la première face du morceau, -1 si aucune
+
+        // Avancement de la lecture
+        size_t positionsRead{0}, normalsRead{0}, uvsRead{0};
+
+        // Faces et événements lus, alloués dans une arène propre au morceau : un
+        // seul bloc pris au tas, à la taille donnée par la passe de comptage (la
+        // ressource monotone arrondirait ses propres blocs à une puissance de 2),
+        // aucune allocation partagée entre threads pendant la lecture, et tout est
+        // rendu d'un coup par la fusion dès que le morceau est rejoué
+        struct Records {
+            std::unique_ptr<unsigned char[]> block; // déclarés avant ce qu'ils servent
+            std::pmr::monotonic_buffer_resource arena;
+            std::pmr::vector<ObjIndex> corners;   // index résolus (0-based, -1 si absent)
+            std::pmr::vector<uint32_t> faceSizes; // nombre de coins de chaque face
+            std::pmr::vector<ObjEvent> events;
+
+            explicit Records(size_t bytes)
+                : block(new unsigned char[bytes]), arena(block.get(), bytes)
+                , corners(&arena), faceSizes(&arena), events(&arena) {}
+        };
+        std::unique_ptr<Records> records; // créé par parseChunk
+        size_t rejectedFaces{0};
+        math::Vec3 boundsMin{0.0f, 0.0f, 0.0f};
+        math::Vec3 boundsMax{0.0f, 0.0f, 0.0f};
     };
 
 private:
-    ObjIndex parseFaceToken(const std::string& token) const;
-    uint32_t getOrCreateVertex(const ObjIndex& idx);
+    bool loadWithStream(const std::string& filepath, const std::string& baseDir);
+    bool loadWithMapping(const std::string& filepath, const std::string& baseDir);
+    bool loadCompressed(const std::string& filepath, const std::string& baseDir);
 
-	bool loadMtlFromFile(const std::string& filepath);
+    // Lit un .mtl ; ses textures partent en décodage sans être attendues
+    bool readMtl(const std::string& filepath);
+    void addMaterial(MTLMaterial& mat);
+    void requestTexture(const MTLMaterial& mat);
+    void queueTexture(const std::string& path);
+    void resolveTextures();
+    // Lit les mtllib des premières lignes (avant toute autre instruction) pour
+    // que leurs textures se décodent pendant la lecture des morceaux
+    void readHeaderMtllibs(const char* p, const char* end, const std::string& baseDir);
+
+    void addPosition(const math::Vec3& v);
+    void useMaterial(const std::string& name);
+    void markMaterialUsed(const std::string& name);
+    bool resolveCorner(ObjIndex& idx, int positionCount, int uvCount, int normalCount) const;
+    uint32_t emitCorner(ObjIndex idx, int missingNormal);
+    static int smoothingSlot(const std::string& arg, std::unordered_map<std::string, int>& slots);
+    void generateNormals();
+    void notePeakHeap();
+    void releaseAttributes();
+    static void triangulateFan(const uint32_t* faceIndices, size_t count, uint32_t* out);
+    uint32_t groupSlot(const std::string& name);
+    uint32_t submeshSlot(uint32_t group, const std::string& material);
+    std::vector<uint32_t> orderSubmeshes();
+    void computeGroupBounds();
+
+    size_t chunkCountFor(size_t size) const;
+    void parseBlock(const char* begin, const char* end, size_t chunkCount,
+        std::vector<ObjChunk>& chunks, int& faceFormat);
+    void countChunk(ObjChunk& chunk) const;
+    void parseChunk(ObjChunk& chunk, int faceFormat);
+    template <int Format>
+    const char* parseRecords(ObjChunk& chunk, const char* from);
+    static int detectFaceFormat(const char* p, const char* eol);
+    void mergeChunks(std::vector<ObjChunk>& chunks, const std::string& baseDir);
+
+    bool parseFaceToken(const char* begin, const char* end, ObjIndex& out) const;
+    uint32_t getOrCreateVertex(const ObjIndex& idx);
+    // Remplit m_vertices, à sa taille exacte, depuis les entrées de m_dedup
+    void buildVerticesFromDedup();
 
     int fixIndex(int idx, int size) const;
 };
@@ -0,0 +1,78 @@
+#ifndef PARALLEL_H
+# define PARALLEL_H
+
+# include <cstddef>
+# include <exception>
+# include <thread>
+# include <vector>
+
+namespace parallel
+{
+	// Nombre de threads utilisables (au moins 1)
+	inline unsigned hardwareThreads()
+	{
+		const unsigned n = std::thread::hardware_concurrency();
+		return n == 0 ? 1u : n;
+	}
+
+	// Joint les threads lances, y compris quand une exception remonte avant la fin
+	class JoinGuard
+	{
+		public:
+			explicit JoinGuard(std::vector<std::thread>& threads) : m_threads(threads) {}
+			~JoinGuard()
+			{
+				for (std::size_t i = 0; i < m_threads.size(); ++i)
+					if (m_threads[i].joinable())
+						m_threads[i].join();
+			}
+
+		private:
+			JoinGuard(const JoinGuard&);
+			JoinGuard& operator=(const JoinGuard&);
+
+			std::vector<std::thread>& m_threads;
+	};
+
+	// Appelle fn(i) pour i dans [0, count) : un thread par index, l'index 0
+	// tourne sur le thread appelant. Retourne quand tous les appels sont finis.
+	// Une exception levee par un appel (sur n'importe quel thread) est relancee
+	// ici une fois tous les threads joints ; s'il y en a plusieurs, celle du plus
+	// petit index.
+	template <typename Fn>
+	void forEachIndex(std::size_t count, Fn fn)
+	{
+		if (count == 0)
+			return;
+		std::vector<std::exception_ptr> errors(count);
+		{
+			std::vector<std::thread> workers;
+			workers.reserve(count - 1);
+			JoinGuard guard(workers);
+			for (std::size_t i = 1; i < count; ++i)
+				workers.push_back(std::thread([&errors, fn, i]() mutable {
+					try
+					{
+						fn(i);
+					}
+					catch (...)
+					{
+						errors[i] = std::current_exception();
+					}
+				}));
+			try
+			{
+				fn(static_cast<std::size_t>(0));
+			}
+			catch (...)
+			{
+				errors[0] = std::current_exception();
+			}
+		}
+		for (std::size_t i = 0; i < count; ++i)
+			if (errors[i])
+				std::rethrow_exception(errors[i]);
+	}
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef PPM_IMAGE_H
+# define PPM_IMAGE_H
+
+# include <cstddef>
+# include <string>
+# include <vector>
+
+// Decodage des images PPM : P3 (texte) et P6 (binaire, 8 ou 16 bits par
+// composante), vers le format envoye tel quel a glTexImage2D : RGB 8 bits,
+// 3 octets par pixel, lignes sans bourrage (GL_UNPACK_ALIGNMENT a 1).
+//
+// Les composantes sont ramenees de [0, maxval] a [0, 255] par une table
+// calculee une fois par image ; une valeur au-dela de maxval donne 255.
+// P6 en 8 bits avec maxval 255 est une simple copie. En P3, les debuts de
+// nombres viennent des masques de blancs de textscan::classify (SSE2/AVX2), et
+// chaque nombre est converti depuis 8 octets lus d'un coup, dans un registre
+// de 64 bits (SWAR), au lieu d'un chiffre par tour de boucle.
+namespace ppm
+{
+	// Decode [data, data + size) dans rgb ; false et error rempli si l'image
+	// est invalide ou tronquee
+	bool decode(const char* data, std::size_t size, std::vector<unsigned char>& rgb,
+		int& width, int& height, std::string& error);
+
+	// Projette le fichier en memoire et le decode ; false et message sur
+	// std::cerr s'il est illisible
+	bool load(const std::string& path, std::vector<unsigned char>& rgb, int& width, int& height);
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef SPSC_QUEUE_H
+# define SPSC_QUEUE_H
+
+# include <atomic>
+# include <cstddef>
+# include <utility>
+# include <vector>
+
+// File bornee sans verrou entre exactement un producteur et un consommateur.
+//
+// Anneau de capacite puissance de 2 : le producteur n'ecrit que m_tail, le
+// consommateur que m_head ; chacun lit l'autre en acquire pour voir les cases
+// publiees. Les deux compteurs sont sur des lignes de cache differentes.
+// push() echoue si la file est pleine, pop() si elle est vide : l'attente
+// eventuelle est laissee a l'appelant.
+template <typename T>
+class SpscQueue
+{
+	public:
+		explicit SpscQueue(std::size_t minCapacity)
+			: m_slots(roundUp(minCapacity))
+			, m_mask(m_slots.size() - 1)
+			, m_head(0)
+			, m_tail(0)
+		{
+		}
+
+		// Producteur
+		bool push(T& value)
+		{
+			const std::size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+				return false;
+			m_slots[tail & m_mask] = std::move(value);
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consommateur
+		bool pop(T& out)
+		{
+			const std::size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_tail.load(std::memory_order_acquire))
+				return false;
+			out = std::move(m_slots[head & m_mask]);
+			m_slots[head & m_mask] = T();
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Indicatif hors du consommateur : peut changer aussitot
+		bool empty() const
+		{
+			return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+		}
+
+	private:
+		SpscQueue(const SpscQueue&);
+		SpscQueue& operator=(const SpscQueue&);
+
+		static std::size_t roundUp(std::size_t n)
+		{
+			std::size_t capacity = 1;
+			while (capacity < n)
+				capacity *= 2;
+			return capacity;
+		}
+
+	private:
+		std::vector<T> m_slots;
+		const std::size_t m_mask;
+		alignas(64) std::atomic<std::size_t> m_head;
+		alignas(64) std::atomic<std::size_t> m_tail;
+};
+
+#endif
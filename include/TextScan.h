@@ -0,0 +1,52 @@
+#ifndef TEXT_SCAN_H
+# define TEXT_SCAN_H
+
+# include <cstddef>
+# include <cstdint>
+
+// Recherche de separateurs dans du texte (OBJ, MTL, PPM) par blocs de 64 octets.
+//
+// Chaque bloc est classe en masques de bits (bit i = octet p[i]) : fins de ligne,
+// blancs, '#'. Les fonctions de recherche ne font ensuite que des operations sur
+// ces masques (ctz, popcount) au lieu de tester les octets un par un.
+// Le classement est fait en AVX2 ou SSE2 selon le processeur (choix a
+// l'execution), sinon par une boucle scalaire.
+namespace textscan
+{
+	enum Level
+	{
+		LEVEL_SCALAR,
+		LEVEL_SSE2,
+		LEVEL_AVX2
+	};
+
+	struct BlockMasks
+	{
+		std::uint64_t newline; // '\n'
+		std::uint64_t space;   // ' ', '\t', '\n', '\v', '\f', '\r'
+		std::uint64_t hash;    // '#'
+	};
+
+	// Classe les octets [p, min(p + 64, end)) ; les bits au-dela de end restent a 0.
+	// Rien n'est lu au-dela de end : un bloc incomplet est d'abord copie.
+	void classify(const char* p, const char* end, BlockMasks& out);
+
+	// Premier '\n' de [p, end), ou end
+	const char* findNewline(const char* p, const char* end);
+	// Premier blanc (fin de ligne comprise) de [p, end), ou end
+	const char* findSpace(const char* p, const char* end);
+	// Premier octet qui n'est pas un blanc (fin de ligne comprise), ou end
+	const char* skipSpaces(const char* p, const char* end);
+	// Nombre de mots separes par des blancs avant le premier mot qui commence par '#'
+	std::size_t countWords(const char* p, const char* end);
+
+	// Niveau utilise, et le meilleur que le processeur permet
+	Level activeLevel();
+	Level bestLevel();
+	// Impose un niveau (mesures, voir scop_bench --simd) ; false s'il depasse
+	// bestLevel(). A appeler hors de tout chargement en cours.
+	bool forceLevel(Level level);
+	const char* levelName(Level level);
+}
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TEXTURE_DECODER_H
+# define TEXTURE_DECODER_H
+
+# include <condition_variable>
+# include <cstddef>
+# include <deque>
+# include <mutex>
+# include <string>
+# include <thread>
+# include <unordered_map>
+# include <vector>
+
+// Decodage des textures PPM en arriere-plan, pendant que le reste du chargement
+// continue. submit() met un fichier en file et rend la main aussitot ; des
+// threads (demarres au besoin, au plus maxThreads) le decodent par ppm::load.
+// Un chemin soumis plusieurs fois n'est decode qu'une fois.
+//
+// Le chargement ne dure alors plus la somme des textures mais a peu pres la
+// plus longue d'entre elles. Un seul thread appelle submit/wait/find.
+class TextureDecoder
+{
+	public:
+		struct Image
+		{
+			std::string path;
+			std::vector<unsigned char> rgb; // RGB 8 bits, voir ppm::decode
+			int width{0};
+			int height{0};
+			bool ok{false};
+		};
+
+		// 0 : parallel::hardwareThreads()
+		explicit TextureDecoder(unsigned maxThreads = 0);
+		// Abandonne les textures pas encore commencees et attend celles en cours
+		~TextureDecoder();
+
+		void submit(const std::string& path);
+		// Attend que toutes les textures soumises soient decodees
+		void wait();
+		// Texture de path apres wait(), NULL si path n'a pas ete soumis
+		Image* find(const std::string& path);
+
+	private:
+		TextureDecoder(const TextureDecoder&);
+		TextureDecoder& operator=(const TextureDecoder&);
+
+		void work();
+
+	private:
+		const unsigned m_maxThreads;
+		std::mutex m_mutex;
+		std::condition_variable m_wake; // texture en file ou arret
+		std::condition_variable m_done; // une texture finie
+		std::deque<Image> m_images;     // references stables pendant les ajouts
+		std::unordered_map<std::string, std::size_t> m_byPath;
+		std::size_t m_next;    // prochaine texture a commencer
+		std::size_t m_pending; // soumises et pas encore finies
+		bool m_stop;
+		std::vector<std::thread> m_threads;
+};
+
+#endif
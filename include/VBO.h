@@ -10,6 +10,8 @@ class VBO
         GLuint ID;
         VBO(GLfloat *vertices, GLsizeiptr size);
 
+        // Remplace size octets a partir de offset (le buffer doit etre lie)
+        void Update(GLintptr offset, const void* data, GLsizeiptr size);
         void Bind();
         void Unbind();
         void Delete();
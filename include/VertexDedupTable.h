@@ -0,0 +1,124 @@
+#ifndef VERTEX_DEDUP_TABLE_H
+# define VERTEX_DEDUP_TABLE_H
+
+# include <cstddef>
+# include <cstdint>
+# include <vector>
+
+// Table a adressage ouvert (sondage lineaire) qui associe un coin de face OBJ
+// (v, vt, vn, index 0-based, -1 si absent) a l'index de son vertex final.
+//
+// Les trois index sont empaquetes dans une cle 64 bits dont la largeur de chaque
+// champ depend du nombre de positions/uvs/normales du fichier. Si la somme des
+// largeurs depasse 64 bits, la cle garde v et vt et vn est compare a part.
+// Les cles, valeurs et complements sont dans des tableaux separes : le sondage
+// ne parcourt que les cles.
+class VertexDedupTable
+{
+	public:
+		VertexDedupTable();
+
+		// Vide la table et la dimensionne pour environ expectedEntries coins uniques.
+		// Les index devront etre inferieurs aux compteurs donnes.
+		void reset(std::size_t positionCount, std::size_t uvCount, std::size_t normalCount,
+			std::size_t expectedEntries);
+		// Rend la memoire
+		void release();
+
+		// Si le coin est deja connu, ecrit sa valeur dans outValue et retourne false.
+		// Sinon l'insere avec newValue et retourne true.
+		bool findOrInsert(int v, int vt, int vn, std::uint32_t newValue, std::uint32_t& outValue);
+
+		// Appelle fn(v, vt, vn, valeur) pour chaque coin insere, dans un ordre quelconque
+		template <typename Fn>
+		void forEach(Fn fn) const;
+
+		std::size_t size() const { return m_size; }
+		std::size_t capacity() const { return m_keys.size(); }
+
+	private:
+		// Melangeur final de MurmurHash3 : chaque bit de la cle influe sur tout le hache
+		static std::uint64_t mix(std::uint64_t k)
+		{
+			k ^= k >> 33;
+			k *= 0xff51afd7ed558ccdULL;
+			k ^= k >> 33;
+			k *= 0xc4ceb9fe1a85ec53ULL;
+			k ^= k >> 33;
+			return k;
+		}
+
+		std::uint64_t hashOf(std::uint64_t key, std::uint32_t extra) const
+		{
+			if (m_wide)
+				key ^= static_cast<std::uint64_t>(extra) * 0x9e3779b97f4a7c15ULL;
+			return mix(key);
+		}
+
+		void allocate(std::size_t slotCount);
+		void grow();
+
+	private:
+		std::vector<std::uint64_t> m_keys;   // 0 = case vide (les champs sont stockes +1)
+		std::vector<std::uint32_t> m_values;
+		std::vector<std::uint32_t> m_extra;  // vn + 1, seulement si m_wide
+		std::size_t m_size;
+		std::size_t m_mask;
+		unsigned m_vtShift;
+		unsigned m_vnShift;
+		bool m_wide;
+};
+
+inline bool VertexDedupTable::findOrInsert(int v, int vt, int vn, std::uint32_t newValue, std::uint32_t& outValue)
+{
+	const std::uint64_t a = static_cast<std::uint64_t>(static_cast<std::uint32_t>(v + 1));
+	const std::uint64_t b = static_cast<std::uint64_t>(static_cast<std::uint32_t>(vt + 1));
+	const std::uint32_t c = static_cast<std::uint32_t>(vn + 1);
+	const std::uint64_t key = m_wide
+		? (a | (b << 32))
+		: (a | (b << m_vtShift) | (static_cast<std::uint64_t>(c) << m_vnShift));
+	std::size_t slot = static_cast<std::size_t>(hashOf(key, c)) & m_mask;
+	for (;;)
+	{
+		const std::uint64_t k = m_keys[slot];
+		if (k == 0)
+			break;
+		if (k == key && (!m_wide || m_extra[slot] == c))
+		{
+			outValue = m_values[slot];
+			return false;
+		}
+		slot = (slot + 1) & m_mask;
+	}
+
+	m_keys[slot] = key;
+	m_values[slot] = newValue;
+	if (m_wide)
+		m_extra[slot] = c;
+	outValue = newValue;
+	// Facteur de charge maximal 3/4 : au-dela le sondage lineaire s'allonge vite
+	if (++m_size * 4 > m_keys.size() * 3)
+		grow();
+	return true;
+}
+
+template <typename Fn>
+void VertexDedupTable::forEach(Fn fn) const
+{
+	const std::uint64_t vMask = m_wide ? 0xffffffffULL : ((1ULL << m_vtShift) - 1);
+	const std::uint64_t vtMask = m_wide ? 0xffffffffULL : ((1ULL << (m_vnShift - m_vtShift)) - 1);
+	const unsigned vtShift = m_wide ? 32u : m_vtShift;
+	for (std::size_t slot = 0; slot < m_keys.size(); ++slot)
+	{
+		const std::uint64_t key = m_keys[slot];
+		if (key == 0)
+			continue;
+		const std::uint64_t c = m_wide ? m_extra[slot] : (key >> m_vnShift);
+		fn(static_cast<int>(key & vMask) - 1,
+			static_cast<int>((key >> vtShift) & vtMask) - 1,
+			static_cast<int>(c) - 1,
+			m_values[slot]);
+	}
+}
+
+#endif
@@ -154,6 +154,11 @@ const std::vector<std::string>& Application::argvObjPaths() const
 	return m_input.argvObjPaths();
 }
 
+std::string Application::nextArgvObjPath() const
+{
+	return m_input.nextArgvObjPath();
+}
+
 bool Application::hasPendingObjPath() const
 {
 	return m_input.hasPendingObjPath();
@@ -164,6 +169,11 @@ std::string Application::consumePendingObjPath()
 	return m_input.consumePendingObjPath();
 }
 
+int Application::consumeGroupSteps()
+{
+	return m_input.consumeGroupSteps();
+}
+
 void Application::attachToWindow(GLFWwindow* window)
 {
 	m_window = window;
@@ -0,0 +1,454 @@
+#include "../include/AssetPipeline.h"
+#include "../include/Parallel.h"
+
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <iostream>
+
+namespace
+{
+	// Places par file : un travail en cours dans l'etape suivante et un d'avance
+	const std::size_t kQueueCapacity = 2;
+	const std::size_t kRequestCapacity = 8;
+
+	std::size_t textureBytes(const MTLMaterial& mat)
+	{
+		return static_cast<std::size_t>(mat.textureWidth) * static_cast<std::size_t>(mat.textureHeight) * 3u;
+	}
+
+	// Envoie la texture PPM decodee d'un materiau ; 0 si le materiau n'en a pas
+	GLuint uploadTexture(const MTLMaterial& mat)
+	{
+		const int w = mat.textureWidth;
+		const int h = mat.textureHeight;
+		if (w <= 0 || h <= 0 || mat.textureData.size() < textureBytes(mat))
+			return 0;
+
+		GLuint textureId = 0;
+		glGenTextures(1, &textureId);
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, mat.textureData.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return textureId;
+	}
+
+	// Le modele GPU garde les proprietes des materiaux, pas leurs pixels
+	MTLMaterial withoutPixels(const MTLMaterial& mat)
+	{
+		MTLMaterial out;
+		out.name = mat.name;
+		out.Ka = mat.Ka;
+		out.Kd = mat.Kd;
+		out.Ks = mat.Ks;
+		out.Ns = mat.Ns;
+		out.d = mat.d;
+		out.illum = mat.illum;
+		out.map_Kd = mat.map_Kd;
+		out.texturePath = mat.texturePath;
+		out.textureWidth = mat.textureWidth;
+		out.textureHeight = mat.textureHeight;
+		return out;
+	}
+}
+
+std::size_t DecodedModel::byteSize() const
+{
+	std::size_t bytes = geometry.vertices.size() * sizeof(Vertex)
+		+ geometry.indices.size() * sizeof(std::uint32_t)
+		+ geometry.submeshes.size() * sizeof(Submesh)
+		+ geometry.groups.size() * sizeof(MeshGroup);
+	for (std::unordered_map<std::string, MTLMaterial>::const_iterator it = materials.begin(); it != materials.end(); ++it)
+		bytes += sizeof(MTLMaterial) + it->second.textureData.size();
+	return bytes;
+}
+
+void GpuModel::release()
+{
+	if (mesh)
+		mesh->Delete();
+	mesh.reset();
+	for (std::unordered_map<std::string, GLuint>::const_iterator it = textures.begin(); it != textures.end(); ++it)
+		if (it->second != 0)
+			glDeleteTextures(1, &it->second);
+	textures.clear();
+}
+
+void AssetPipeline::WakeSignal::notify()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_raised = true;
+	m_cond.notify_one();
+}
+
+void AssetPipeline::WakeSignal::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_cond.wait(lock, [this] { return m_raised; });
+	m_raised = false;
+}
+
+AssetPipeline::AssetPipeline(std::size_t slotCount, const Settings& settings)
+	: m_settings(settings)
+	, m_generations()
+	, m_delivered(slotCount, 0)
+	, m_stop(false)
+	, m_loaders()
+	, m_nextLoader(0)
+	, m_decoded(kQueueCapacity)
+	, m_backlog()
+	, m_textureWake()
+	, m_upload()
+	, m_keepDecodedBytes(0)
+	, m_textureThread()
+{
+	for (std::size_t i = 0; i < slotCount; ++i)
+		m_generations.push_back(std::unique_ptr<std::atomic<std::uint64_t> >(new std::atomic<std::uint64_t>(0)));
+
+	// Chaque fichier est deja lu en morceaux paralleles : au-dela d'un thread
+	// par coeur, les chargements simultanes ne font que se partager les coeurs
+	std::size_t loaderCount = settings.loadThreads;
+	if (loaderCount == 0)
+		loaderCount = std::min<std::size_t>(parallel::hardwareThreads(), slotCount);
+	if (loaderCount == 0)
+		loaderCount = 1;
+	for (std::size_t i = 0; i < loaderCount; ++i)
+		m_loaders.push_back(std::unique_ptr<Loader>(new Loader(kRequestCapacity, kQueueCapacity)));
+	for (std::size_t i = 0; i < m_loaders.size(); ++i)
+		m_loaders[i]->thread = std::thread(&AssetPipeline::loadStage, this, std::ref(*m_loaders[i]));
+	m_textureThread = std::thread(&AssetPipeline::textureStage, this);
+}
+
+AssetPipeline::~AssetPipeline()
+{
+	m_stop.store(true);
+	for (std::size_t i = 0; i < m_loaders.size(); ++i)
+		m_loaders[i]->wake.notify();
+	m_textureWake.notify();
+	for (std::size_t i = 0; i < m_loaders.size(); ++i)
+		m_loaders[i]->thread.join();
+	m_textureThread.join();
+	if (m_upload.active)
+		m_upload.model.release();
+	// Les travaux restes dans les files n'ont pas d'objet GL
+}
+
+bool AssetPipeline::isCurrent(const Job& job) const
+{
+	return m_generations[job.slot]->load(std::memory_order_acquire) == job.generation;
+}
+
+bool AssetPipeline::isLoading(std::size_t slot) const
+{
+	return m_generations[slot]->load(std::memory_order_relaxed) != m_delivered[slot];
+}
+
+void AssetPipeline::request(std::size_t slot, const std::string& path)
+{
+	Job job;
+	job.slot = slot;
+	job.generation = m_generations[slot]->fetch_add(1) + 1;
+	job.path = path;
+	m_backlog.push_back(std::move(job));
+	while (!m_backlog.empty() && dispatch(m_backlog.front()))
+		m_backlog.pop_front();
+}
+
+void AssetPipeline::prefetch(std::size_t slot, const std::string& path)
+{
+	Job job;
+	job.slot = slot;
+	job.generation = m_generations[slot]->fetch_add(1) + 1;
+	job.path = path;
+	job.prefetch = true;
+	m_backlog.push_back(std::move(job));
+	while (!m_backlog.empty() && dispatch(m_backlog.front()))
+		m_backlog.pop_front();
+}
+
+void AssetPipeline::upload(std::size_t slot, const std::string& path, const std::shared_ptr<DecodedModel>& decoded)
+{
+	Job job;
+	job.slot = slot;
+	job.generation = m_generations[slot]->fetch_add(1) + 1;
+	job.path = path;
+	job.decoded = decoded;
+	job.shared = true;
+	job.ok = true;
+	m_ready.push_back(std::move(job));
+}
+
+bool AssetPipeline::dispatch(Job& job)
+{
+	for (std::size_t tried = 0; tried < m_loaders.size(); ++tried)
+	{
+		Loader& loader = *m_loaders[m_nextLoader];
+		m_nextLoader = (m_nextLoader + 1) % m_loaders.size();
+		if (loader.requests.push(job))
+		{
+			loader.wake.notify();
+			return true;
+		}
+	}
+	return false;
+}
+
+bool AssetPipeline::forward(Job& job, SpscQueue<Job>& out, WakeSignal& self, WakeSignal* consumer)
+{
+	while (!out.push(job))
+	{
+		if (m_stop.load())
+			return false;
+		self.wait();
+	}
+	if (consumer)
+		consumer->notify();
+	return true;
+}
+
+// Lecture, analyse et deduplication : tout le travail de OBJParser::loadFromFile.
+// Chaque travail a son propre OBJParser, rien n'est partage entre les threads "load"
+void AssetPipeline::loadStage(Loader& loader)
+{
+	while (!m_stop.load())
+	{
+		Job job;
+		if (!loader.requests.pop(job))
+		{
+			loader.wake.wait();
+			continue;
+		}
+		if (!isCurrent(job))
+			continue;
+		job.parser.reset(new OBJParser());
+		job.parser->setUseCache(m_settings.useCache);
+		job.parser->setGenerateNormals(m_settings.generateNormals);
+		job.parser->setDeferTextureDecode(true);
+		// Une exception du chargement (memoire epuisee sur un gros fichier) fait
+		// echouer ce modele seulement, pas le thread
+		try
+		{
+			job.ok = job.parser->loadFromFile(job.path);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "OBJ load error: " << e.what() << "\n";
+			job.ok = false;
+		}
+		if (!job.ok)
+			std::cerr << "Failed to load OBJ file: " << job.path << "\n";
+		else
+		{
+			job.decoded = std::make_shared<DecodedModel>();
+			job.decoded->geometry = job.parser->takeMeshData();
+			job.decoded->boundsMin = job.parser->getBoundsMin();
+			job.decoded->boundsMax = job.parser->getBoundsMax();
+			job.decoded->hasUVs = job.parser->hasUVs();
+		}
+		if (!isCurrent(job))
+			continue;
+		forward(job, loader.parsed, loader.wake, &m_textureWake);
+	}
+}
+
+// Prend tour a tour dans la file de sortie de chaque thread "load"
+void AssetPipeline::textureStage()
+{
+	while (!m_stop.load())
+	{
+		bool found = false;
+		for (std::size_t i = 0; i < m_loaders.size() && !m_stop.load(); ++i)
+		{
+			Loader& loader = *m_loaders[i];
+			Job job;
+			if (!loader.parsed.pop(job))
+				continue;
+			found = true;
+			loader.wake.notify(); // une place s'est liberee dans sa file de sortie
+			if (!isCurrent(job))
+				continue;
+			if (job.ok)
+			{
+				job.parser->decodeTextures();
+				job.decoded->materials = job.parser->takeMaterials();
+			}
+			job.parser.reset();
+			if (!isCurrent(job))
+				continue;
+			// Le thread GL relit m_decoded a chaque image : rien a reveiller
+			forward(job, m_decoded, m_textureWake, NULL);
+		}
+		if (!found)
+			m_textureWake.wait();
+	}
+}
+
+void AssetPipeline::startUpload(Job& job)
+{
+	DecodedModel& decoded = *job.decoded;
+	MeshData& geometry = decoded.geometry;
+	GpuModel& model = m_upload.model;
+	model = GpuModel();
+	model.path = job.path;
+	model.mesh.reset(new Mesh(geometry.vertices.size(), geometry.indices.size()));
+	model.gpuBytes = geometry.vertices.size() * sizeof(Vertex) + geometry.indices.size() * sizeof(std::uint32_t);
+	m_upload.keepDecoded = job.shared || (m_keepDecodedBytes > 0 && decoded.byteSize() <= m_keepDecodedBytes);
+	if (m_upload.keepDecoded)
+	{
+		model.submeshes = geometry.submeshes;
+		model.groups = geometry.groups;
+	}
+	else
+	{
+		model.submeshes = std::move(geometry.submeshes);
+		model.groups = std::move(geometry.groups);
+	}
+	model.boundsMin = decoded.boundsMin;
+	model.boundsMax = decoded.boundsMax;
+	model.hasUVs = decoded.hasUVs;
+
+	// Une texture par fichier map_Kd, partagee entre les materiaux qui la citent ;
+	// un materiau jamais cite par usemtl n'a pas de pixels et n'en envoie pas
+	m_upload.textures.clear();
+	const std::unordered_map<std::string, MTLMaterial>& mats = decoded.materials;
+	for (std::unordered_map<std::string, MTLMaterial>::const_iterator it = mats.begin(); it != mats.end(); ++it)
+	{
+		model.materials[it->first] = withoutPixels(it->second);
+		if (it->second.textureData.empty() || model.textures.count(it->second.map_Kd))
+			continue;
+		model.textures[it->second.map_Kd] = 0;
+		m_upload.textures.push_back(&it->second);
+		model.gpuBytes += textureBytes(it->second) / 3u * 4u; // mipmaps : un tiers de plus
+	}
+
+	m_upload.verticesSent = 0;
+	m_upload.indicesSent = 0;
+	m_upload.texturesSent = 0;
+	m_upload.job = std::move(job);
+	m_upload.active = true;
+}
+
+// Envoie des morceaux de l'envoi en cours tant que budget le permet ; le premier
+// morceau de l'appel passe toujours, pour qu'un gros element finisse par partir.
+// Retourne true quand tout est envoye. Vertices et index sont liberes des
+// qu'ils sont entierement sur le GPU, sauf si le DecodedModel est garde.
+bool AssetPipeline::continueUpload(std::size_t& budget)
+{
+	MeshData& geometry = m_upload.job.decoded->geometry;
+	const bool keep = m_upload.keepDecoded;
+	Mesh& mesh = *m_upload.model.mesh;
+	bool first = true;
+
+	std::vector<Vertex>& vertices = geometry.vertices;
+	while (m_upload.verticesSent < vertices.size())
+	{
+		if (!first && budget < sizeof(Vertex))
+			return false;
+		std::size_t count = budget / sizeof(Vertex);
+		if (count == 0)
+			count = 1;
+		if (count > vertices.size() - m_upload.verticesSent)
+			count = vertices.size() - m_upload.verticesSent;
+		mesh.UploadVertices(m_upload.verticesSent, vertices.data() + m_upload.verticesSent, count);
+		m_upload.verticesSent += count;
+		budget -= (count * sizeof(Vertex) < budget) ? count * sizeof(Vertex) : budget;
+		first = false;
+	}
+	if (!keep)
+		std::vector<Vertex>().swap(vertices);
+
+	std::vector<std::uint32_t>& indices = geometry.indices;
+	while (m_upload.indicesSent < indices.size())
+	{
+		if (!first && budget < sizeof(std::uint32_t))
+			return false;
+		std::size_t count = budget / sizeof(std::uint32_t);
+		if (count == 0)
+			count = 1;
+		if (count > indices.size() - m_upload.indicesSent)
+			count = indices.size() - m_upload.indicesSent;
+		mesh.UploadIndices(m_upload.indicesSent, indices.data() + m_upload.indicesSent, count);
+		m_upload.indicesSent += count;
+		budget -= (count * sizeof(std::uint32_t) < budget) ? count * sizeof(std::uint32_t) : budget;
+		first = false;
+	}
+	if (!keep)
+		std::vector<std::uint32_t>().swap(indices);
+
+	while (m_upload.texturesSent < m_upload.textures.size())
+	{
+		const MTLMaterial& mat = *m_upload.textures[m_upload.texturesSent];
+		const std::size_t bytes = textureBytes(mat);
+		if (!first && bytes > budget)
+			return false;
+		m_upload.model.textures[mat.map_Kd] = uploadTexture(mat);
+		++m_upload.texturesSent;
+		budget -= (bytes < budget) ? bytes : budget;
+		first = false;
+	}
+	return true;
+}
+
+bool AssetPipeline::pump(std::size_t& budgetBytes, Completion& done)
+{
+	while (!m_backlog.empty() && dispatch(m_backlog.front()))
+		m_backlog.pop_front();
+
+	for (;;)
+	{
+		if (m_upload.active && !isCurrent(m_upload.job))
+		{
+			// Remplace par une demande plus recente : les objets GL deja crees sont rendus
+			m_upload.model.release();
+			m_upload = Upload();
+		}
+		if (!m_upload.active)
+		{
+			// Les modeles deja decodes passent avant ceux qui sortent du pipeline
+			Job job;
+			if (!m_ready.empty())
+			{
+				job = std::move(m_ready.front());
+				m_ready.pop_front();
+			}
+			else if (m_decoded.pop(job))
+				m_textureWake.notify(); // une place s'est liberee dans m_decoded
+			else
+				return false;
+			if (!isCurrent(job))
+				continue;
+			if (!job.ok || job.prefetch)
+			{
+				m_delivered[job.slot] = job.generation;
+				done = Completion();
+				done.slot = job.slot;
+				done.path = job.path;
+				done.ok = job.ok;
+				done.decoded = job.decoded;
+				done.prefetched = job.prefetch;
+				return true;
+			}
+			startUpload(job);
+		}
+		if (!continueUpload(budgetBytes))
+			return false;
+
+		const std::size_t slot = m_upload.job.slot;
+		m_delivered[slot] = m_upload.job.generation;
+		done = Completion();
+		done.slot = slot;
+		done.path = m_upload.job.path;
+		done.ok = true;
+		done.model = std::move(m_upload.model);
+		if (m_upload.keepDecoded)
+			done.decoded = m_upload.job.decoded;
+		m_upload = Upload();
+		return true;
+	}
+}
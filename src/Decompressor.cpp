@@ -0,0 +1,221 @@
+#include "../include/Decompressor.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#ifdef SCOP_HAVE_ZLIB
+# include <zlib.h>
+#endif
+#ifdef SCOP_HAVE_ZSTD
+# include <zstd.h>
+#endif
+
+namespace
+{
+	const unsigned char kGzipMagic[2] = {0x1f, 0x8b};
+	const unsigned char kZstdMagic[4] = {0x28, 0xb5, 0x2f, 0xfd};
+
+	// zlib compte les octets en uInt : l'entree lui est donnee par tranches
+	const std::size_t kMaxSlice = 1u << 30;
+}
+
+Decompressor::Decompressor()
+	: m_file()
+	, m_format(FORMAT_NONE)
+	, m_state(NULL)
+	, m_consumed(0)
+	, m_finished(false)
+	, m_failed(false)
+{
+}
+
+Decompressor::~Decompressor()
+{
+	close();
+}
+
+Decompressor::Format Decompressor::detect(const char* data, std::size_t size)
+{
+	if (size >= sizeof(kGzipMagic) && std::memcmp(data, kGzipMagic, sizeof(kGzipMagic)) == 0)
+		return FORMAT_GZIP;
+	if (size >= sizeof(kZstdMagic) && std::memcmp(data, kZstdMagic, sizeof(kZstdMagic)) == 0)
+		return FORMAT_ZSTD;
+	return FORMAT_NONE;
+}
+
+Decompressor::Format Decompressor::detectFile(const std::string& path)
+{
+	std::ifstream in(path.c_str(), std::ios::binary);
+	char magic[4] = {0, 0, 0, 0};
+	in.read(magic, sizeof(magic));
+	return detect(magic, static_cast<std::size_t>(in.gcount()));
+}
+
+bool Decompressor::open(const std::string& path)
+{
+	close();
+	if (!m_file.open(path))
+	{
+		std::cerr << "Decompressor: impossible d'ouvrir " << path << "\n";
+		return false;
+	}
+	m_format = detect(m_file.begin(), m_file.size());
+
+	if (m_format == FORMAT_GZIP)
+	{
+#ifdef SCOP_HAVE_ZLIB
+		z_stream* stream = new z_stream();
+		// 15 + 32 : fenetre maximale, en-tete gzip ou zlib reconnu automatiquement
+		if (inflateInit2(stream, 15 + 32) != Z_OK)
+		{
+			delete stream;
+			std::cerr << "Decompressor: initialisation zlib impossible\n";
+			close();
+			return false;
+		}
+		m_state = stream;
+		return true;
+#endif
+	}
+	else if (m_format == FORMAT_ZSTD)
+	{
+#ifdef SCOP_HAVE_ZSTD
+		ZSTD_DStream* stream = ZSTD_createDStream();
+		if (stream == NULL)
+		{
+			std::cerr << "Decompressor: initialisation zstd impossible\n";
+			close();
+			return false;
+		}
+		m_state = stream;
+		return true;
+#endif
+	}
+
+	if (m_format == FORMAT_NONE)
+		std::cerr << "Decompressor: " << path << " n'est ni gzip ni zstd\n";
+	else
+		std::cerr << "Decompressor: " << path << " : format "
+			<< (m_format == FORMAT_GZIP ? "gzip" : "zstd") << " non pris en charge par cette compilation\n";
+	close();
+	return false;
+}
+
+void Decompressor::close()
+{
+#ifdef SCOP_HAVE_ZLIB
+	if (m_state != NULL && m_format == FORMAT_GZIP)
+	{
+		z_stream* stream = static_cast<z_stream*>(m_state);
+		inflateEnd(stream);
+		delete stream;
+	}
+#endif
+#ifdef SCOP_HAVE_ZSTD
+	if (m_state != NULL && m_format == FORMAT_ZSTD)
+		ZSTD_freeDStream(static_cast<ZSTD_DStream*>(m_state));
+#endif
+	m_file.close();
+	m_state = NULL;
+	m_format = FORMAT_NONE;
+	m_consumed = 0;
+	m_finished = false;
+	m_failed = false;
+}
+
+std::size_t Decompressor::read(char* out, std::size_t capacity)
+{
+	if (m_state == NULL || m_finished || m_failed || capacity == 0)
+		return 0;
+	if (m_format == FORMAT_GZIP)
+		return readGzip(out, capacity);
+	return readZstd(out, capacity);
+}
+
+std::size_t Decompressor::readGzip(char* out, std::size_t capacity)
+{
+#ifdef SCOP_HAVE_ZLIB
+	z_stream* stream = static_cast<z_stream*>(m_state);
+	std::size_t written = 0;
+	while (written < capacity)
+	{
+		const std::size_t inLeft = m_file.size() - m_consumed;
+		const std::size_t outLeft = capacity - written;
+		stream->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(m_file.begin() + m_consumed));
+		stream->avail_in = static_cast<uInt>(inLeft < kMaxSlice ? inLeft : kMaxSlice);
+		stream->next_out = reinterpret_cast<Bytef*>(out + written);
+		stream->avail_out = static_cast<uInt>(outLeft < kMaxSlice ? outLeft : kMaxSlice);
+		const uInt inBefore = stream->avail_in;
+		const uInt outBefore = stream->avail_out;
+
+		const int ret = inflate(stream, Z_NO_FLUSH);
+		m_consumed += inBefore - stream->avail_in;
+		written += outBefore - stream->avail_out;
+
+		if (ret == Z_STREAM_END)
+		{
+			// Plusieurs membres gzip concatenes forment un seul fichier (gzip -c a b)
+			if (m_consumed < m_file.size() && inflateReset(stream) == Z_OK)
+				continue;
+			m_finished = true;
+			break;
+		}
+		if (ret != Z_OK && !(ret == Z_BUF_ERROR && written > 0))
+		{
+			std::cerr << "Decompressor: flux gzip invalide ou tronque\n";
+			m_failed = true;
+			break;
+		}
+		if (m_consumed == m_file.size() && stream->avail_out != 0)
+		{
+			std::cerr << "Decompressor: flux gzip tronque\n";
+			m_failed = true;
+			break;
+		}
+	}
+	return written;
+#else
+	(void)out;
+	(void)capacity;
+	return 0;
+#endif
+}
+
+std::size_t Decompressor::readZstd(char* out, std::size_t capacity)
+{
+#ifdef SCOP_HAVE_ZSTD
+	ZSTD_DStream* stream = static_cast<ZSTD_DStream*>(m_state);
+	ZSTD_outBuffer output = {out, capacity, 0};
+	while (output.pos < output.size)
+	{
+		ZSTD_inBuffer input = {m_file.begin(), m_file.size(), m_consumed};
+		const std::size_t ret = ZSTD_decompressStream(stream, &output, &input);
+		m_consumed = input.pos;
+		if (ZSTD_isError(ret))
+		{
+			std::cerr << "Decompressor: flux zstd invalide (" << ZSTD_getErrorName(ret) << ")\n";
+			m_failed = true;
+			break;
+		}
+		// ret == 0 : fin d'une trame ; d'autres trames peuvent suivre
+		if (ret == 0 && m_consumed == m_file.size())
+		{
+			m_finished = true;
+			break;
+		}
+		// Tout est lu, la trame n'est pas finie et le decodeur a tout rendu
+		if (m_consumed == m_file.size() && output.pos < output.size)
+		{
+			std::cerr << "Decompressor: flux zstd tronque\n";
+			m_failed = true;
+			break;
+		}
+	}
+	return output.pos;
+#else
+	(void)out;
+	(void)capacity;
+	return 0;
+#endif
+}
@@ -7,6 +7,11 @@ EBO::EBO(GLuint* indices, GLsizeiptr size)
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, size, indices, GL_STATIC_DRAW);
 }
 
+void EBO::Update(GLintptr offset, const void* data, GLsizeiptr size)
+{
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, offset, size, data);
+}
+
 void EBO::Bind()
 {
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
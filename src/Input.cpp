@@ -8,6 +8,7 @@ Input::Input()
 	, m_pendingObjPath()
 	, m_argvObjPaths()
 	, m_nextArgvIndex(0)
+	, m_groupSteps(0)
 {
 	std::memset(m_keys, 0, sizeof(m_keys));
 }
@@ -29,6 +30,13 @@ const std::vector<std::string>& Input::argvObjPaths() const
 	return m_argvObjPaths;
 }
 
+std::string Input::nextArgvObjPath() const
+{
+	if (m_nextArgvIndex < m_argvObjPaths.size())
+		return m_argvObjPaths[m_nextArgvIndex];
+	return std::string();
+}
+
 bool Input::keyDown(int glfwKey) const
 {
 	if (glfwKey < 0 || glfwKey >= KEY_MAX)
@@ -49,6 +57,13 @@ std::string Input::consumePendingObjPath()
 	return out;
 }
 
+int Input::consumeGroupSteps()
+{
+	const int steps = m_groupSteps;
+	m_groupSteps = 0;
+	return steps;
+}
+
 void Input::onKey(GLFWwindow* window, int key, int action)
 {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
@@ -63,6 +78,12 @@ void Input::onKey(GLFWwindow* window, int key, int action)
 		return;
 	}
 
+	if (key == GLFW_KEY_G && action == GLFW_PRESS)
+	{
+		++m_groupSteps;
+		return;
+	}
+
 	if (key == GLFW_KEY_TAB && action == GLFW_PRESS)
 	{
 		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
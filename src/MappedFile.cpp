@@ -0,0 +1,81 @@
+#include "../include/MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile()
+	: m_data(NULL)
+	, m_size(0)
+	, m_open(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+	{
+		::close(fd);
+		return false;
+	}
+
+	// mmap refuse une longueur nulle : un fichier vide est une plage vide valide.
+	if (st.st_size > 0)
+	{
+		void* data = mmap(NULL, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		madvise(data, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+		m_data = data;
+		m_size = static_cast<std::size_t>(st.st_size);
+	}
+	// La projection reste valide apres fermeture du descripteur.
+	::close(fd);
+	m_open = true;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (m_data)
+		munmap(m_data, m_size);
+	m_data = NULL;
+	m_size = 0;
+	m_open = false;
+}
+
+bool MappedFile::isOpen() const
+{
+	return m_open;
+}
+
+const char* MappedFile::begin() const
+{
+	return static_cast<const char*>(m_data);
+}
+
+const char* MappedFile::end() const
+{
+	return static_cast<const char*>(m_data) + m_size;
+}
+
+std::size_t MappedFile::size() const
+{
+	return m_size;
+}
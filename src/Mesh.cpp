@@ -21,6 +21,43 @@ Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<std::uint32_t>
 	m_ebo->Unbind();
 }
 
+Mesh::Mesh(std::size_t vertexCount, std::size_t indexCount)
+	: m_vao()
+	, m_vbo()
+	, m_ebo()
+	, m_indexCount(static_cast<GLsizei>(indexCount))
+{
+	m_vao.Bind();
+	m_vbo.reset(new VBO(NULL, static_cast<GLsizeiptr>(vertexCount * sizeof(Vertex))));
+	m_ebo.reset(new EBO(NULL, static_cast<GLsizeiptr>(indexCount * sizeof(std::uint32_t))));
+
+	m_vao.LinkAttrib(*m_vbo, 0, 3, GL_FLOAT, sizeof(Vertex), (void*)0); // position
+	m_vao.LinkAttrib(*m_vbo, 1, 3, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, normal)); // normal
+	m_vao.LinkAttrib(*m_vbo, 2, 2, GL_FLOAT, sizeof(Vertex), (void*)offsetof(Vertex, uv)); // uv
+
+	m_vao.Unbind();
+	m_vbo->Unbind();
+	m_ebo->Unbind();
+}
+
+void Mesh::UploadVertices(std::size_t first, const Vertex* vertices, std::size_t count)
+{
+	m_vbo->Bind();
+	m_vbo->Update(static_cast<GLintptr>(first * sizeof(Vertex)), vertices,
+		static_cast<GLsizeiptr>(count * sizeof(Vertex)));
+	m_vbo->Unbind();
+}
+
+void Mesh::UploadIndices(std::size_t first, const std::uint32_t* indices, std::size_t count)
+{
+	// L'EBO est lie au VAO : le lier hors du VAO changerait l'etat du VAO courant
+	m_vao.Bind();
+	m_ebo->Bind();
+	m_ebo->Update(static_cast<GLintptr>(first * sizeof(std::uint32_t)), indices,
+		static_cast<GLsizeiptr>(count * sizeof(std::uint32_t)));
+	m_vao.Unbind();
+}
+
 void Mesh::Bind() { m_vao.Bind(); }
 
 void Mesh::Unbind() { m_vao.Unbind(); }
@@ -33,6 +70,18 @@ void Mesh::Draw()
 	glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_INT, 0);
 }
 
+void Mesh::DrawRanges(const GLsizei* firstIndices, const GLsizei* counts, GLsizei rangeCount)
+{
+	m_rangeOffsets.resize(static_cast<std::size_t>(rangeCount));
+	for (GLsizei i = 0; i < rangeCount; ++i)
+	{
+		const std::uintptr_t offset = static_cast<std::uintptr_t>(firstIndices[i]) * sizeof(std::uint32_t);
+		m_rangeOffsets[static_cast<std::size_t>(i)] = reinterpret_cast<const void*>(offset);
+	}
+	m_vao.Bind();
+	glMultiDrawElements(GL_TRIANGLES, counts, GL_UNSIGNED_INT, m_rangeOffsets.data(), rangeCount);
+}
+
 void Mesh::Delete()
 {
 	m_vao.Delete();
@@ -45,8 +94,10 @@ void Mesh::Delete()
 void Mesh::loadFromOBJ(const std::string& filepath)
 {
 	m_parser.loadFromFile(filepath);
-	const std::vector<Vertex>& verticesData = m_parser.getVertices();
-	const std::vector<uint32_t>& indicesData = m_parser.getIndices();
+	// La geometrie quitte le parser et disparait une fois envoyee
+	MeshData data = m_parser.takeMeshData();
+	const std::vector<Vertex>& verticesData = data.vertices;
+	const std::vector<uint32_t>& indicesData = data.indices;
 
 	m_indexCount = static_cast<GLsizei>(indicesData.size());
 
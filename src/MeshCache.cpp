@@ -0,0 +1,522 @@
+#include "../include/MeshCache.h"
+#include "../include/MappedFile.h"
+#include "../include/OBJParser.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+const std::uint32_t MeshCache::kVersion;
+
+static const char kMagic[8] = {'S', 'C', 'O', 'P', 'B', 'I', 'N', '\0'};
+static const char kTextureMagic[8] = {'S', 'C', 'O', 'P', 'T', 'E', 'X', '\0'};
+
+// --- Ecriture : chaque section part directement dans le fichier, sans copie
+// du cache entier en memoire (vertices, index et texels ne sont pas doubles) ---
+
+namespace
+{
+	class BinWriter
+	{
+		public:
+			explicit BinWriter(std::ofstream& file) : m_file(file) {}
+
+			void bytes(const void* data, std::size_t size)
+			{
+				if (size > 0)
+					m_file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+			}
+
+			template <typename T>
+			void pod(const T& value) { bytes(&value, sizeof(T)); }
+
+			void str(const std::string& s)
+			{
+				pod(static_cast<std::uint32_t>(s.size()));
+				bytes(s.data(), s.size());
+			}
+
+			bool ok() const { return m_file.good(); }
+
+		private:
+			std::ofstream& m_file;
+	};
+
+	// Lecture bornee dans la projection du cache ; ok() devient faux au premier debordement
+	class BinReader
+	{
+		public:
+			BinReader(const char* begin, const char* end)
+				: m_p(begin)
+				, m_end(end)
+				, m_ok(true)
+			{
+			}
+
+			bool bytes(void* out, std::size_t size)
+			{
+				if (!m_ok || static_cast<std::size_t>(m_end - m_p) < size)
+					return (m_ok = false);
+				std::memcpy(out, m_p, size);
+				m_p += size;
+				return true;
+			}
+
+			template <typename T>
+			bool pod(T& out) { return bytes(&out, sizeof(T)); }
+
+			bool str(std::string& out)
+			{
+				std::uint32_t size = 0;
+				if (!pod(size) || static_cast<std::size_t>(m_end - m_p) < size)
+					return (m_ok = false);
+				out.assign(m_p, size);
+				m_p += size;
+				return true;
+			}
+
+			// Copie un tableau de count elements directement depuis la projection
+			template <typename T>
+			bool array(std::vector<T>& out, std::uint64_t count)
+			{
+				if (!m_ok || count > static_cast<std::uint64_t>(m_end - m_p) / sizeof(T))
+					return (m_ok = false);
+				out.resize(static_cast<std::size_t>(count));
+				return bytes(out.data(), static_cast<std::size_t>(count) * sizeof(T));
+			}
+
+			bool ok() const { return m_ok; }
+
+		private:
+			const char* m_p;
+			const char* m_end;
+			bool m_ok;
+	};
+}
+
+std::string MeshCache::cachePathFor(const std::string& sourcePath)
+{
+	return sourcePath + ".scopbin";
+}
+
+std::string MeshCache::textureCachePathFor(const std::string& sourcePath)
+{
+	return sourcePath + ".scoptex";
+}
+
+// Ecriture dans un fichier temporaire puis renommage : un lecteur ne voit
+// jamais un cache a moitie ecrit. Le temporaire porte l'id du thread, deux
+// chargements simultanes du meme fichier n'ecrivent pas dans le meme
+static std::string temporaryPathFor(const std::string& path)
+{
+	std::ostringstream tmpName;
+	tmpName << path << ".tmp." << std::this_thread::get_id();
+	return tmpName.str();
+}
+
+static bool commitTemporary(std::ofstream& file, bool written, const std::string& tmpPath, const std::string& path)
+{
+	file.close();
+	if (!written || file.fail() || std::rename(tmpPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tmpPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::statFile(const std::string& path, std::uint64_t& size, std::int64_t& mtimeNs)
+{
+	struct stat st;
+	if (stat(path.c_str(), &st) != 0)
+		return false;
+	size = static_cast<std::uint64_t>(st.st_size);
+	mtimeNs = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+	return true;
+}
+
+std::uint64_t MeshCache::hashBytes(const char* data, std::size_t size)
+{
+	const std::uint64_t k = 0x9e3779b97f4a7c15ULL;
+	std::uint64_t h = 0xcbf29ce484222325ULL ^ (size * k);
+	std::size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		std::uint64_t w;
+		std::memcpy(&w, data + i, 8);
+		h = (h ^ (w * k)) * 0xff51afd7ed558ccdULL;
+		h ^= h >> 29;
+	}
+	std::uint64_t tail = 0;
+	if (size > i) // data peut etre nul pour un fichier vide
+		std::memcpy(&tail, data + i, size - i);
+	h = (h ^ (tail * k)) * 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 32;
+	return h;
+}
+
+// Identite du fichier source : chemin, taille, date et hache du contenu
+static bool sourceKey(const std::string& sourcePath, std::uint64_t& size, std::int64_t& mtimeNs, std::uint64_t& hash)
+{
+	MappedFile source;
+	if (!MeshCache::statFile(sourcePath, size, mtimeNs) || !source.open(sourcePath))
+		return false;
+	hash = MeshCache::hashBytes(source.begin(), source.size());
+	return true;
+}
+
+// Defait ce qu'un cache illisible a deja rempli ; le reste du parser (chemin
+// source, reglages) sert encore au chargement texte qui suit
+void MeshCache::discardCachedData(OBJParser& parser)
+{
+	parser.m_boundsMin = math::Vec3{0.0f, 0.0f, 0.0f};
+	parser.m_boundsMax = math::Vec3{0.0f, 0.0f, 0.0f};
+	parser.m_hasUVs = false;
+	parser.m_activeMaterial.clear();
+	parser.m_firstUsedMaterial.clear();
+	parser.m_materials.clear();
+	parser.m_usedMaterials.clear();
+	std::vector<Vertex>().swap(parser.m_vertices);
+	std::vector<std::uint32_t>().swap(parser.m_indices);
+	parser.m_submeshes.clear();
+	parser.m_groups.clear();
+}
+
+// Vrai si chaque index designe un vertex existant
+static bool indicesInRange(const std::vector<std::uint32_t>& indices, std::uint64_t vertexCount)
+{
+	std::uint32_t maxIndex = 0;
+	for (std::size_t i = 0; i < indices.size(); ++i)
+		maxIndex = indices[i] > maxIndex ? indices[i] : maxIndex;
+	return indices.empty() || maxIndex < vertexCount;
+}
+
+bool MeshCache::load(const std::string& sourcePath, OBJParser& parser)
+{
+	MappedFile file;
+	if (!file.open(cachePathFor(sourcePath)))
+		return false;
+
+	std::uint64_t size = 0;
+	std::int64_t mtimeNs = 0;
+	std::uint64_t hash = 0;
+	if (!sourceKey(sourcePath, size, mtimeNs, hash))
+		return false;
+
+	BinReader in(file.begin(), file.end());
+	char magic[8];
+	std::uint32_t version = 0;
+	std::string cachedPath;
+	std::uint64_t cachedSize = 0;
+	std::int64_t cachedMtime = 0;
+	std::uint64_t cachedHash = 0;
+	std::uint8_t generatedNormals = 0;
+	in.bytes(magic, sizeof(magic));
+	in.pod(version);
+	in.str(cachedPath);
+	in.pod(cachedSize);
+	in.pod(cachedMtime);
+	in.pod(cachedHash);
+	in.pod(generatedNormals);
+	// Les normales generees changent les vertices : un cache ecrit avec l'autre
+	// reglage ne correspond pas
+	if (!in.ok() || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 || version != kVersion
+		|| cachedPath != sourcePath || cachedSize != size || cachedMtime != mtimeNs || cachedHash != hash
+		|| (generatedNormals != 0) != parser.m_generateNormals)
+		return false;
+
+	// Dependances (.mtl, .ppm) : taille et date identiques, ou toujours absentes
+	std::uint32_t depCount = 0;
+	in.pod(depCount);
+	std::vector<std::string> dependencies;
+	for (std::uint32_t i = 0; i < depCount && in.ok(); ++i)
+	{
+		std::string path;
+		std::uint64_t depSize = 0;
+		std::int64_t depMtime = 0;
+		in.str(path);
+		in.pod(depSize);
+		in.pod(depMtime);
+		std::uint64_t curSize = ~0ULL;
+		std::int64_t curMtime = 0;
+		statFile(path, curSize, curMtime);
+		if (curSize != depSize || (curSize != ~0ULL && curMtime != depMtime))
+			return false;
+		dependencies.push_back(path);
+	}
+
+	// Le parser a ete vide par loadFromFile ; en cas d'echec, discardCachedData defait ce qui a ete lu
+	std::uint8_t hasUVs = 0;
+	in.pod(parser.m_boundsMin);
+	in.pod(parser.m_boundsMax);
+	in.pod(hasUVs);
+	parser.m_hasUVs = (hasUVs != 0);
+	in.str(parser.m_activeMaterial);
+	in.str(parser.m_firstUsedMaterial);
+
+	std::uint32_t materialCount = 0;
+	in.pod(materialCount);
+	for (std::uint32_t i = 0; i < materialCount && in.ok(); ++i)
+	{
+		MTLMaterial m;
+		std::uint64_t textureBytes = 0;
+		in.str(m.name);
+		in.pod(m.Ka);
+		in.pod(m.Kd);
+		in.pod(m.Ks);
+		in.pod(m.Ns);
+		in.pod(m.d);
+		in.pod(m.illum);
+		in.str(m.map_Kd);
+		in.str(m.texturePath);
+		in.pod(m.textureWidth);
+		in.pod(m.textureHeight);
+		in.pod(textureBytes);
+		in.array(m.textureData, textureBytes);
+		const std::string name = m.name;
+		parser.m_materials[name] = std::move(m);
+	}
+	// Materiaux cites par usemtl, y compris ceux qu'aucune face ne suit
+	std::uint32_t usedCount = 0;
+	in.pod(usedCount);
+	for (std::uint32_t i = 0; i < usedCount && in.ok(); ++i)
+	{
+		std::string name;
+		in.str(name);
+		parser.m_usedMaterials.insert(name);
+	}
+
+	std::uint64_t vertexCount = 0;
+	std::uint64_t indexCount = 0;
+	in.pod(vertexCount);
+	in.array(parser.m_vertices, vertexCount);
+	in.pod(indexCount);
+	in.array(parser.m_indices, indexCount);
+	// Un index hors des vertices irait jusqu'a glDrawElements
+	const bool indicesValid = in.ok() && indicesInRange(parser.m_indices, vertexCount);
+
+	std::uint32_t submeshCount = 0;
+	in.pod(submeshCount);
+	for (std::uint32_t i = 0; i < submeshCount && in.ok(); ++i)
+	{
+		Submesh submesh;
+		in.str(submesh.material);
+		in.pod(submesh.firstIndex);
+		in.pod(submesh.indexCount);
+		in.pod(submesh.group);
+		if (static_cast<std::uint64_t>(submesh.firstIndex) + submesh.indexCount > indexCount)
+			break;
+		parser.m_submeshes.push_back(submesh);
+	}
+
+	std::uint32_t groupCount = 0;
+	in.pod(groupCount);
+	for (std::uint32_t i = 0; i < groupCount && in.ok(); ++i)
+	{
+		MeshGroup group;
+		in.str(group.name);
+		in.pod(group.firstIndex);
+		in.pod(group.indexCount);
+		in.pod(group.firstSubmesh);
+		in.pod(group.submeshCount);
+		in.pod(group.boundsMin);
+		in.pod(group.boundsMax);
+		if (static_cast<std::uint64_t>(group.firstIndex) + group.indexCount > indexCount
+			|| static_cast<std::uint64_t>(group.firstSubmesh) + group.submeshCount > submeshCount)
+			break;
+		parser.m_groups.push_back(group);
+	}
+	if (!in.ok() || !indicesValid || parser.m_submeshes.size() != submeshCount || parser.m_groups.size() != groupCount)
+	{
+		discardCachedData(parser);
+		return false;
+	}
+	parser.m_dependencies.swap(dependencies);
+	return true;
+}
+
+bool MeshCache::store(const std::string& sourcePath, const OBJParser& parser)
+{
+	std::uint64_t size = 0;
+	std::int64_t mtimeNs = 0;
+	std::uint64_t hash = 0;
+	if (!sourceKey(sourcePath, size, mtimeNs, hash))
+		return false;
+
+	const std::string path = cachePathFor(sourcePath);
+	const std::string tmpPath = temporaryPathFor(path);
+	std::ofstream file(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	BinWriter out(file);
+	out.bytes(kMagic, sizeof(kMagic));
+	out.pod(kVersion);
+	out.str(sourcePath);
+	out.pod(size);
+	out.pod(mtimeNs);
+	out.pod(hash);
+	out.pod(static_cast<std::uint8_t>(parser.m_generateNormals ? 1 : 0));
+
+	out.pod(static_cast<std::uint32_t>(parser.m_dependencies.size()));
+	for (std::size_t i = 0; i < parser.m_dependencies.size(); ++i)
+	{
+		std::uint64_t depSize = ~0ULL;
+		std::int64_t depMtime = 0;
+		statFile(parser.m_dependencies[i], depSize, depMtime);
+		out.str(parser.m_dependencies[i]);
+		out.pod(depSize);
+		out.pod(depMtime);
+	}
+
+	out.pod(parser.m_boundsMin);
+	out.pod(parser.m_boundsMax);
+	out.pod(static_cast<std::uint8_t>(parser.m_hasUVs ? 1 : 0));
+	out.str(parser.m_activeMaterial);
+	out.str(parser.m_firstUsedMaterial);
+
+	out.pod(static_cast<std::uint32_t>(parser.m_materials.size()));
+	for (std::unordered_map<std::string, MTLMaterial>::const_iterator it = parser.m_materials.begin();
+		it != parser.m_materials.end(); ++it)
+	{
+		const MTLMaterial& m = it->second;
+		out.str(m.name);
+		out.pod(m.Ka);
+		out.pod(m.Kd);
+		out.pod(m.Ks);
+		out.pod(m.Ns);
+		out.pod(m.d);
+		out.pod(m.illum);
+		out.str(m.map_Kd);
+		out.str(m.texturePath);
+		out.pod(m.textureWidth);
+		out.pod(m.textureHeight);
+		out.pod(static_cast<std::uint64_t>(m.textureData.size()));
+		out.bytes(m.textureData.data(), m.textureData.size());
+	}
+	out.pod(static_cast<std::uint32_t>(parser.m_usedMaterials.size()));
+	for (std::unordered_set<std::string>::const_iterator it = parser.m_usedMaterials.begin();
+		it != parser.m_usedMaterials.end(); ++it)
+		out.str(*it);
+
+	out.pod(static_cast<std::uint64_t>(parser.m_vertices.size()));
+	out.bytes(parser.m_vertices.data(), parser.m_vertices.size() * sizeof(Vertex));
+	out.pod(static_cast<std::uint64_t>(parser.m_indices.size()));
+	out.bytes(parser.m_indices.data(), parser.m_indices.size() * sizeof(std::uint32_t));
+
+	out.pod(static_cast<std::uint32_t>(parser.m_submeshes.size()));
+	for (std::size_t i = 0; i < parser.m_submeshes.size(); ++i)
+	{
+		out.str(parser.m_submeshes[i].material);
+		out.pod(parser.m_submeshes[i].firstIndex);
+		out.pod(parser.m_submeshes[i].indexCount);
+		out.pod(parser.m_submeshes[i].group);
+	}
+
+	out.pod(static_cast<std::uint32_t>(parser.m_groups.size()));
+	for (std::size_t i = 0; i < parser.m_groups.size(); ++i)
+	{
+		const MeshGroup& group = parser.m_groups[i];
+		out.str(group.name);
+		out.pod(group.firstIndex);
+		out.pod(group.indexCount);
+		out.pod(group.firstSubmesh);
+		out.pod(group.submeshCount);
+		out.pod(group.boundsMin);
+		out.pod(group.boundsMax);
+	}
+
+	return commitTemporary(file, out.ok(), tmpPath, path);
+}
+
+bool MeshCache::loadTextures(const std::string& sourcePath, OBJParser& parser)
+{
+	MappedFile file;
+	if (!file.open(textureCachePathFor(sourcePath)))
+		return false;
+
+	BinReader in(file.begin(), file.end());
+	char magic[8];
+	std::uint32_t version = 0;
+	std::uint32_t textureCount = 0;
+	in.bytes(magic, sizeof(magic));
+	in.pod(version);
+	in.pod(textureCount);
+	if (!in.ok() || std::memcmp(magic, kTextureMagic, sizeof(kTextureMagic)) != 0 || version != kVersion)
+		return false;
+
+	for (std::uint32_t i = 0; i < textureCount && in.ok(); ++i)
+	{
+		std::string path;
+		std::uint64_t ppmSize = 0;
+		std::int64_t ppmMtime = 0;
+		int width = 0;
+		int height = 0;
+		std::uint64_t textureBytes = 0;
+		std::vector<unsigned char> rgb;
+		in.str(path);
+		in.pod(ppmSize);
+		in.pod(ppmMtime);
+		in.pod(width);
+		in.pod(height);
+		in.pod(textureBytes);
+		in.array(rgb, textureBytes);
+		std::uint64_t curSize = 0;
+		std::int64_t curMtime = 0;
+		if (!in.ok() || !statFile(path, curSize, curMtime) || curSize != ppmSize || curMtime != ppmMtime)
+			continue;
+		for (std::unordered_map<std::string, MTLMaterial>::iterator it = parser.m_materials.begin();
+			it != parser.m_materials.end(); ++it)
+		{
+			MTLMaterial& m = it->second;
+			if (m.texturePath != path || !m.textureData.empty() || !parser.m_usedMaterials.count(it->first))
+				continue;
+			m.textureWidth = width;
+			m.textureHeight = height;
+			m.textureData = rgb;
+		}
+	}
+	return in.ok();
+}
+
+bool MeshCache::storeTextures(const std::string& sourcePath, const OBJParser& parser)
+{
+	// Une entree par .ppm, meme partage par plusieurs materiaux
+	std::vector<const MTLMaterial*> textures;
+	std::unordered_set<std::string> paths;
+	for (std::unordered_map<std::string, MTLMaterial>::const_iterator it = parser.m_materials.begin();
+		it != parser.m_materials.end(); ++it)
+		if (!it->second.textureData.empty() && paths.insert(it->second.texturePath).second)
+			textures.push_back(&it->second);
+
+	const std::string path = textureCachePathFor(sourcePath);
+	const std::string tmpPath = temporaryPathFor(path);
+	std::ofstream file(tmpPath.c_str(), std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	BinWriter out(file);
+	out.bytes(kTextureMagic, sizeof(kTextureMagic));
+	out.pod(kVersion);
+	out.pod(static_cast<std::uint32_t>(textures.size()));
+	for (std::size_t i = 0; i < textures.size(); ++i)
+	{
+		const MTLMaterial& m = *textures[i];
+		std::uint64_t ppmSize = ~0ULL;
+		std::int64_t ppmMtime = 0;
+		statFile(m.texturePath, ppmSize, ppmMtime);
+		out.str(m.texturePath);
+		out.pod(ppmSize);
+		out.pod(ppmMtime);
+		out.pod(m.textureWidth);
+		out.pod(m.textureHeight);
+		out.pod(static_cast<std::uint64_t>(m.textureData.size()));
+		out.bytes(m.textureData.data(), m.textureData.size());
+	}
+	return commitTemporary(file, out.ok(), tmpPath, path);
+}
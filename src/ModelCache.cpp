@@ -0,0 +1,177 @@
+#include "../include/ModelCache.h"
+#include "../include/MeshCache.h"
+
+ModelCache::ModelCache(const Budgets& budgets)
+	: m_budgets(budgets)
+	, m_stats()
+	, m_entries()
+	, m_index()
+	, m_pinned()
+	, m_cpuBytes(0)
+	, m_vramBytes(0)
+{
+}
+
+ModelCache::~ModelCache()
+{
+	for (EntryList::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+		it->gpu.release();
+}
+
+bool ModelCache::isFresh(const Entry& entry)
+{
+	std::uint64_t size = 0;
+	std::int64_t mtimeNs = 0;
+	return MeshCache::statFile(entry.path, size, mtimeNs) && size == entry.size && mtimeNs == entry.mtimeNs;
+}
+
+const GpuModel* ModelCache::lookup(const std::string& path, std::shared_ptr<DecodedModel>& decoded)
+{
+	decoded.reset();
+	std::unordered_map<std::string, EntryList::iterator>::iterator found = m_index.find(path);
+	if (found != m_index.end() && !isFresh(*found->second))
+	{
+		Entry& entry = *found->second;
+		// Le modele affiche reste dessine jusqu'a ce que sa nouvelle version arrive
+		if (entry.path == m_pinned && entry.gpu.mesh)
+		{
+			releaseDecoded(entry);
+			entry.staleGpu = true;
+		}
+		else
+			erase(found->second);
+		++m_stats.misses;
+		return NULL;
+	}
+	if (found == m_index.end())
+	{
+		++m_stats.misses;
+		return NULL;
+	}
+
+	EntryList::iterator it = found->second;
+	m_entries.splice(m_entries.begin(), m_entries, it);
+	if (it->gpu.mesh && !it->staleGpu)
+	{
+		++m_stats.gpuHits;
+		return &it->gpu;
+	}
+	if (!it->decoded)
+	{
+		++m_stats.misses;
+		return NULL;
+	}
+	++m_stats.cpuHits;
+	decoded = it->decoded;
+	return NULL;
+}
+
+bool ModelCache::contains(const std::string& path) const
+{
+	std::unordered_map<std::string, EntryList::iterator>::const_iterator found = m_index.find(path);
+	return found != m_index.end() && (!found->second->staleGpu || found->second->decoded);
+}
+
+const GpuModel* ModelCache::find(const std::string& path) const
+{
+	std::unordered_map<std::string, EntryList::iterator>::const_iterator found = m_index.find(path);
+	if (found == m_index.end() || !found->second->gpu.mesh)
+		return NULL;
+	return &found->second->gpu;
+}
+
+void ModelCache::insert(const std::string& path, GpuModel& model, const std::shared_ptr<DecodedModel>& decoded)
+{
+	// Sans nouvelle copie GPU (prefetch), celle du modele affiche reste dessinee
+	GpuModel previous;
+	std::unordered_map<std::string, EntryList::iterator>::iterator found = m_index.find(path);
+	if (found != m_index.end())
+	{
+		Entry& old = *found->second;
+		if (!model.mesh && old.gpu.mesh && old.path == m_pinned)
+		{
+			m_vramBytes -= old.gpu.gpuBytes;
+			previous = std::move(old.gpu);
+			old.gpu = GpuModel();
+		}
+		erase(found->second);
+	}
+
+	m_entries.push_front(Entry());
+	Entry& entry = m_entries.front();
+	entry.path = path;
+	MeshCache::statFile(path, entry.size, entry.mtimeNs);
+	entry.staleGpu = !model.mesh && previous.mesh;
+	entry.gpu = model.mesh ? std::move(model) : std::move(previous);
+	model = GpuModel();
+	entry.decoded = decoded;
+	entry.decodedBytes = decoded ? decoded->byteSize() : 0;
+	m_vramBytes += entry.gpu.gpuBytes;
+	m_cpuBytes += entry.decodedBytes;
+	m_index[path] = m_entries.begin();
+	trim();
+}
+
+void ModelCache::setPinned(const std::string& path)
+{
+	// Une copie GPU perimee ne servait qu'a l'affichage
+	std::unordered_map<std::string, EntryList::iterator>::iterator found = m_index.find(m_pinned);
+	if (path != m_pinned && found != m_index.end() && found->second->staleGpu)
+	{
+		releaseGpu(*found->second);
+		found->second->staleGpu = false;
+		if (!found->second->decoded)
+			erase(found->second);
+	}
+	m_pinned = path;
+	trim();
+}
+
+ModelCache::EntryList::iterator ModelCache::erase(EntryList::iterator it)
+{
+	releaseGpu(*it);
+	releaseDecoded(*it);
+	m_index.erase(it->path);
+	return m_entries.erase(it);
+}
+
+void ModelCache::releaseGpu(Entry& entry)
+{
+	if (!entry.gpu.mesh)
+		return;
+	m_vramBytes -= entry.gpu.gpuBytes;
+	entry.gpu.release();
+	entry.gpu = GpuModel();
+}
+
+void ModelCache::releaseDecoded(Entry& entry)
+{
+	if (!entry.decoded)
+		return;
+	m_cpuBytes -= entry.decodedBytes;
+	entry.decoded.reset();
+	entry.decodedBytes = 0;
+}
+
+// Parcours depuis la moins recente ; la tete (entree la plus recente) reste
+void ModelCache::trim()
+{
+	EntryList::iterator it = m_entries.end();
+	while (m_vramBytes > m_budgets.vramBytes || m_cpuBytes > m_budgets.cpuBytes)
+	{
+		if (it == m_entries.begin() || --it == m_entries.begin())
+			break;
+		if (m_vramBytes > m_budgets.vramBytes && it->gpu.mesh && it->path != m_pinned)
+		{
+			releaseGpu(*it);
+			++m_stats.gpuEvictions;
+		}
+		if (m_cpuBytes > m_budgets.cpuBytes && it->decoded)
+		{
+			releaseDecoded(*it);
+			++m_stats.cpuEvictions;
+		}
+		if (!it->gpu.mesh && !it->decoded)
+			it = erase(it);
+	}
+}
@@ -0,0 +1,307 @@
+#include "../include/NormalGen.h"
+#include "../include/OBJParser.h"
+#include "../include/Parallel.h"
+#include "../include/TextScan.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define NORMALGEN_X86 1
+#endif
+
+namespace
+{
+	const std::uint32_t kNone = ~static_cast<std::uint32_t>(0);
+
+	// Decoupe [0, count) en parts egales pour la part `part` sur `parts`
+	inline std::size_t rangeBegin(std::size_t count, std::size_t part, std::size_t parts)
+	{
+		return count * part / parts;
+	}
+
+	// Coupe de bucket en paquets pour le tri parallele : au plus kMaxBins paquets
+	const std::size_t kMaxBins = 4096;
+
+	// Range chaque i de [0, count) dont bucketOf(i) n'est pas kNone dans son
+	// bucket : out[offsets[b], offsets[b + 1]) recoit value(i) pour les i du
+	// bucket b, dans l'ordre croissant des i (tri stable).
+	//
+	// Sur un thread : denombrement, somme prefixe, placement a rebours (offsets
+	// revient au debut de chaque bucket). Sur plusieurs, sans operation atomique :
+	// chaque part compte ses elements par paquet de buckets consecutifs et les
+	// place dans sa zone de chaque paquet, puis chaque paquet (a une seule part)
+	// est trie par denombrement. bucketOf est alors appele quatre fois par element.
+	template <typename BucketOf, typename Value>
+	void bucketSort(std::size_t count, std::size_t bucketCount, BucketOf bucketOf, Value value,
+		std::size_t parts, std::vector<std::uint32_t>& offsets, std::vector<std::uint32_t>& out)
+	{
+		offsets.assign(bucketCount + 1, 0);
+		if (parts <= 1)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				if (bucketOf(i) != kNone)
+					++offsets[bucketOf(i)];
+			for (std::size_t b = 1; b < bucketCount; ++b)
+				offsets[b] += offsets[b - 1];
+			offsets[bucketCount] = bucketCount > 0 ? offsets[bucketCount - 1] : 0;
+			out.resize(offsets[bucketCount]);
+			for (std::size_t i = count; i-- > 0;)
+			{
+				const std::uint32_t b = bucketOf(i);
+				if (b != kNone)
+					out[--offsets[b]] = value(i);
+			}
+			return;
+		}
+
+		unsigned shift = 0;
+		while ((bucketCount >> shift) >= kMaxBins)
+			++shift;
+		const std::size_t binCount = ((bucketCount - 1) >> shift) + 1;
+
+		// binCursor[part * binCount + bin] : elements de la part dans le paquet,
+		// puis (somme prefixe paquet par paquet, part par part) debut de sa zone
+		std::vector<std::uint32_t> binCursor(parts * binCount, 0);
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			std::uint32_t* const local = binCursor.data() + part * binCount;
+			const std::size_t end = rangeBegin(count, part + 1, parts);
+			for (std::size_t i = rangeBegin(count, part, parts); i < end; ++i)
+				if (bucketOf(i) != kNone)
+					++local[bucketOf(i) >> shift];
+		});
+		std::vector<std::uint32_t> binBegin(binCount + 1, 0);
+		std::uint32_t total = 0;
+		for (std::size_t bin = 0; bin < binCount; ++bin)
+		{
+			binBegin[bin] = total;
+			for (std::size_t part = 0; part < parts; ++part)
+			{
+				const std::uint32_t n = binCursor[part * binCount + bin];
+				binCursor[part * binCount + bin] = total;
+				total += n;
+			}
+		}
+		binBegin[binCount] = total;
+
+		std::vector<std::uint32_t> binned(total);
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			std::uint32_t* const local = binCursor.data() + part * binCount;
+			const std::size_t end = rangeBegin(count, part + 1, parts);
+			for (std::size_t i = rangeBegin(count, part, parts); i < end; ++i)
+			{
+				const std::uint32_t b = bucketOf(i);
+				if (b != kNone)
+					binned[local[b >> shift]++] = static_cast<std::uint32_t>(i);
+			}
+		});
+		std::vector<std::uint32_t>().swap(binCursor);
+
+		out.resize(total);
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			const std::size_t binEnd = rangeBegin(binCount, part + 1, parts);
+			for (std::size_t bin = rangeBegin(binCount, part, parts); bin < binEnd; ++bin)
+			{
+				const std::size_t firstBucket = bin << shift;
+				const std::size_t lastBucket = std::min(bucketCount, (bin + 1) << shift);
+				for (std::uint32_t k = binBegin[bin]; k < binBegin[bin + 1]; ++k)
+					++offsets[bucketOf(binned[k])];
+				std::uint32_t sum = binBegin[bin];
+				for (std::size_t b = firstBucket; b < lastBucket; ++b)
+					offsets[b] = (sum += offsets[b]);
+				for (std::uint32_t k = binBegin[bin + 1]; k-- > binBegin[bin];)
+					out[--offsets[bucketOf(binned[k])]] = value(binned[k]);
+			}
+		});
+		offsets[bucketCount] = total;
+	}
+
+	// Tri d'une plage courte par insertion (une position, un sommet : quelques
+	// elements), std::sort au-dela
+	template <typename Less>
+	void sortSmall(std::uint32_t* begin, std::uint32_t* end, Less less)
+	{
+		if (end - begin > 16)
+		{
+			std::sort(begin, end, less);
+			return;
+		}
+		for (std::uint32_t* i = begin + 1; i < end; ++i)
+		{
+			const std::uint32_t value = *i;
+			std::uint32_t* j = i;
+			for (; j > begin && less(value, j[-1]); --j)
+				*j = j[-1];
+			*j = value;
+		}
+	}
+
+	// Normale lissee d'une cle : somme des normales (ponderees par l'aire) de
+	// triangles[0, count), dans cet ordre, puis normalisation
+	math::Vec3 smoothNormalScalar(const Vertex* vertices, const std::uint32_t* indices,
+		const std::uint32_t* triangles, std::uint32_t count)
+	{
+		float x = 0.0f, y = 0.0f, z = 0.0f;
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			const std::uint32_t* tri = indices + static_cast<std::size_t>(triangles[k]) * 3;
+			const math::Vec3& p0 = vertices[tri[0]].position;
+			const math::Vec3& p1 = vertices[tri[1]].position;
+			const math::Vec3& p2 = vertices[tri[2]].position;
+			const float ax = p1.x - p0.x, ay = p1.y - p0.y, az = p1.z - p0.z;
+			const float bx = p2.x - p0.x, by = p2.y - p0.y, bz = p2.z - p0.z;
+			x += ay * bz - az * by;
+			y += az * bx - ax * bz;
+			z += ax * by - ay * bx;
+		}
+		const float len = std::sqrt(x * x + y * y + z * z);
+		const float inv = len > 0.0f ? 1.0f / len : 0.0f;
+		return math::Vec3{x * inv, y * inv, z * inv};
+	}
+
+#ifdef NORMALGEN_X86
+	// Position en x, y, z, 0 ; lue en 8 + 4 octets : la normale qui suit dans le
+	// Vertex est ecrite en meme temps par un autre thread
+	__attribute__((target("sse2")))
+	inline __m128 loadPosition(const Vertex& vertex)
+	{
+		const __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(&vertex.position.x));
+		return _mm_movelh_ps(xy, _mm_load_ss(&vertex.position.z));
+	}
+
+	// Memes operations que la version scalaire, dans le meme ordre, sur les trois
+	// composantes a la fois : resultats identiques au bit pres
+	__attribute__((target("sse2")))
+	math::Vec3 smoothNormalSse2(const Vertex* vertices, const std::uint32_t* indices,
+		const std::uint32_t* triangles, std::uint32_t count)
+	{
+		__m128 sum = _mm_setzero_ps();
+		for (std::uint32_t k = 0; k < count; ++k)
+		{
+			const std::uint32_t* tri = indices + static_cast<std::size_t>(triangles[k]) * 3;
+			const __m128 p0 = loadPosition(vertices[tri[0]]);
+			const __m128 a = _mm_sub_ps(loadPosition(vertices[tri[1]]), p0);
+			const __m128 b = _mm_sub_ps(loadPosition(vertices[tri[2]]), p0);
+			// a.yzx * b.zxy - a.zxy * b.yzx
+			const __m128 aYzx = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 aZxy = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+			const __m128 bYzx = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+			const __m128 bZxy = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+			sum = _mm_add_ps(sum, _mm_sub_ps(_mm_mul_ps(aYzx, bZxy), _mm_mul_ps(aZxy, bYzx)));
+		}
+		// (x * x + y * y) + z * z, comme la version scalaire
+		const __m128 sq = _mm_mul_ps(sum, sum);
+		const __m128 xy = _mm_add_ss(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 1, 1, 1)));
+		const __m128 len = _mm_sqrt_ss(_mm_add_ss(xy, _mm_movehl_ps(sq, sq)));
+		const __m128 positive = _mm_cmpgt_ss(len, _mm_setzero_ps());
+		const __m128 inv = _mm_and_ps(_mm_div_ss(_mm_set_ss(1.0f), len), positive);
+		float n[4];
+		_mm_storeu_ps(n, _mm_mul_ps(sum, _mm_shuffle_ps(inv, inv, _MM_SHUFFLE(0, 0, 0, 0))));
+		return math::Vec3{n[0], n[1], n[2]};
+	}
+#endif
+
+	typedef math::Vec3 (*SmoothNormalFn)(const Vertex*, const std::uint32_t*, const std::uint32_t*, std::uint32_t);
+}
+
+namespace normals
+{
+	void generate(std::vector<Vertex>& vertices, const std::vector<std::uint32_t>& indices,
+		const std::vector<std::uint64_t>& keys, unsigned threadCount)
+	{
+		const std::size_t cornerCount = indices.size() / 3 * 3;
+		const std::size_t vertexCount = vertices.size();
+		const std::size_t parts = threadCount == 0 ? 1 : threadCount;
+
+		SmoothNormalFn smoothNormal = smoothNormalScalar;
+#ifdef NORMALGEN_X86
+		if (textscan::activeLevel() != textscan::LEVEL_SCALAR)
+			smoothNormal = smoothNormalSse2;
+#endif
+
+		// 1. Vertices concernes ranges par position (32 bits hauts de la cle)
+		std::vector<std::uint32_t> partMax(parts, 0);
+		std::vector<char> partHasKeys(parts, 0);
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			const std::size_t end = rangeBegin(vertexCount, part + 1, parts);
+			for (std::size_t v = rangeBegin(vertexCount, part, parts); v < end; ++v)
+				if (keys[v] != kKeep)
+				{
+					partMax[part] = std::max(partMax[part], static_cast<std::uint32_t>(keys[v] >> 32));
+					partHasKeys[part] = 1;
+				}
+		});
+		if (std::find(partHasKeys.begin(), partHasKeys.end(), 1) == partHasKeys.end())
+			return;
+		const std::size_t positionCount = static_cast<std::size_t>(*std::max_element(partMax.begin(), partMax.end())) + 1;
+
+		std::vector<std::uint32_t> positionBegin;
+		std::vector<std::uint32_t> members;
+		bucketSort(vertexCount, positionCount,
+			[&keys](std::size_t v) { return keys[v] == kKeep ? kNone : static_cast<std::uint32_t>(keys[v] >> 32); },
+			[](std::size_t v) { return static_cast<std::uint32_t>(v); },
+			parts, positionBegin, members);
+
+		// Chaque position remise dans l'ordre (cle, vertex) : deja le cas sauf
+		// pour les positions a plusieurs normales. Les vertices d'une meme cle se
+		// suivent alors dans members, a partir de members[memberBegin[c]] ; classOf
+		// donne la cle dense. Les cles sont numerotees part par part.
+		const auto byKey = [&keys](std::uint32_t a, std::uint32_t b) {
+			return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+		};
+		std::vector<std::uint32_t> partClasses(parts + 1, 0);
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			const std::size_t end = rangeBegin(positionCount, part + 1, parts);
+			std::uint32_t classes = 0;
+			for (std::size_t p = rangeBegin(positionCount, part, parts); p < end; ++p)
+			{
+				sortSmall(members.data() + positionBegin[p], members.data() + positionBegin[p + 1], byKey);
+				for (std::uint32_t i = positionBegin[p]; i < positionBegin[p + 1]; ++i)
+					if (i == positionBegin[p] || keys[members[i]] != keys[members[i - 1]])
+						++classes;
+			}
+			partClasses[part + 1] = classes;
+		});
+		for (std::size_t part = 1; part <= parts; ++part)
+			partClasses[part] += partClasses[part - 1];
+		const std::size_t classCount = partClasses[parts];
+		std::vector<std::uint32_t> classOf(vertexCount, kNone);
+		std::vector<std::uint32_t> memberBegin(classCount + 1);
+		memberBegin[classCount] = static_cast<std::uint32_t>(members.size());
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			const std::size_t end = rangeBegin(positionCount, part + 1, parts);
+			std::uint32_t c = partClasses[part];
+			for (std::size_t p = rangeBegin(positionCount, part, parts); p < end; ++p)
+				for (std::uint32_t i = positionBegin[p]; i < positionBegin[p + 1]; ++i)
+				{
+					if (i == positionBegin[p] || keys[members[i]] != keys[members[i - 1]])
+						memberBegin[c++] = i;
+					classOf[members[i]] = c - 1;
+				}
+		});
+		std::vector<std::uint32_t>().swap(positionBegin);
+
+		// 2. CSR : triangles de chaque cle (un par coin), dans l'ordre des index
+		std::vector<std::uint32_t> offsets;
+		std::vector<std::uint32_t> faces;
+		bucketSort(cornerCount, classCount,
+			[&](std::size_t i) { return classOf[indices[i]]; },
+			[](std::size_t i) { return static_cast<std::uint32_t>(i / 3); },
+			parts, offsets, faces);
+		std::vector<std::uint32_t>().swap(classOf);
+
+		// 3. Pour chaque cle : somme des normales de ses triangles, normalisation,
+		// copie dans chacun de ses vertices
+		parallel::forEachIndex(parts, [&](std::size_t part) {
+			const std::size_t end = rangeBegin(classCount, part + 1, parts);
+			for (std::size_t c = rangeBegin(classCount, part, parts); c < end; ++c)
+			{
+				const math::Vec3 normal = smoothNormal(vertices.data(), indices.data(),
+					faces.data() + offsets[c], offsets[c + 1] - offsets[c]);
+				for (std::uint32_t m = memberBegin[c]; m < memberBegin[c + 1]; ++m)
+					vertices[members[m]].normal = normal;
+			}
+		});
+	}
+}
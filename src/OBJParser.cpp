@@ -1,24 +1,29 @@
 #include "../include/OBJParser.h"
+#include "../include/Decompressor.h"
+#include "../include/InlineBuffer.h"
+#include "../include/MappedFile.h"
+#include "../include/MeshCache.h"
+#include "../include/NormalGen.h"
+#include "../include/NumberScan.h"
+#include "../include/Parallel.h"
+#include "../include/TextScan.h"
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <mutex>
+#include <new>
 #include <sstream>
 #include <unordered_map>
 #include <iostream>
-
-static bool readPpmToken(std::istream& in, std::string& outTok)
-{
-    while (in >> outTok)
-    {
-        if (!outTok.empty() && outTok[0] == '#')
-        {
-            std::string rest;
-            std::getline(in, rest);
-            continue;
-        }
-        return true;
-    }
-    return false;
-}
+#include <malloc.h>
+#include <thread>
 
 static std::string ltrim(std::string s)
 {
@@ -26,16 +31,55 @@ static std::string ltrim(std::string s)
     return s;
 }
 
-// opérateur d'égalité pour ObjIndex
-bool OBJParser::ObjIndex::operator==(const ObjIndex& other) const {
-    return v == other.v && vt == other.vt && vn == other.vn;
+// Coins de face gardés sans allocation ; au-delà (n-gones), passage au tas
+static const size_t kInlineCorners = 16;
+
+// --- Lecture en place d'une plage d'octets (lecteur mmap) ---
+// Aucune de ces fonctions n'alloue ni ne suppose de '\0' final.
+
+using scan::skipBlanks;
+
+// Fin du mot commençant en p ; dans une ligne, les blancs sont les séparateurs
+static const char* tokenEnd(const char* p, const char* end)
+{
+    return textscan::findSpace(p, end);
 }
 
-// fonction de hachage pour ObjIndex pour utilisation dans unordered_map
-size_t OBJParser::ObjIndexHash::operator()(const ObjIndex& k) const {
-    return ((k.v * 73856093) ^
-            (k.vt * 19349663) ^
-            (k.vn * 83492791));
+// Fin de la ligne commençant en p ('\n' ou end)
+static const char* lineEnd(const char* p, const char* end)
+{
+    return textscan::findNewline(p, end);
+}
+
+static bool tokenEquals(const char* b, const char* e, const char* word)
+{
+    const size_t n = std::strlen(word);
+    return static_cast<size_t>(e - b) == n && std::memcmp(b, word, n) == 0;
+}
+
+// Lit jusqu'à trois flottants ; les composantes manquantes gardent leur valeur
+static void readVec3(const char* p, const char* end, math::Vec3& out)
+{
+    if (scan::nextFloat(p, end, out.x) && scan::nextFloat(p, end, out.y))
+        scan::nextFloat(p, end, out.z);
+}
+
+// Reste de la ligne sans les blancs de début et de fin
+static std::string restOfLine(const char* p, const char* end)
+{
+    p = skipBlanks(p, end);
+    while (end > p && scan::isBlank(end[-1]))
+        --end;
+    return std::string(p, end);
+}
+
+// Idem, alloué dans arena
+static std::pmr::string restOfLine(const char* p, const char* end, std::pmr::memory_resource* arena)
+{
+    p = skipBlanks(p, end);
+    while (end > p && scan::isBlank(end[-1]))
+        --end;
+    return std::pmr::string(p, end, arena);
 }
 
 // Vide toutes les données chargées
@@ -45,12 +89,26 @@ void OBJParser::clear() {
     m_uvs.clear();
     m_vertices.clear();
     m_indices.clear();
+    m_submeshes.clear();
+    m_groups.clear();
+    m_groupSlots.clear();
+    m_submeshSlots.clear();
     m_materials.clear();
     m_activeMaterial.clear();
     m_firstUsedMaterial.clear();
+    m_usedMaterials.clear();
     m_boundsMin = math::Vec3{0.0f, 0.0f, 0.0f};
     m_boundsMax = math::Vec3{0.0f, 0.0f, 0.0f};
     m_hasUVs = false;
+    m_rejectedFaces = 0;
+    m_loadedFromCache = false;
+    m_sourcePath.clear();
+    m_dependencies.clear();
+    m_textureDecoder.reset();
+    m_headerMtllibs = 0;
+    std::vector<uint64_t>().swap(m_normalKeys);
+    m_loadStats = LoadStats();
+    m_dedup.release();
 }
 
 std::string OBJParser::directoryOf(const std::string& filepath)
@@ -63,163 +121,177 @@ std::string OBJParser::directoryOf(const std::string& filepath)
     return filepath.substr(0, slash);
 }
 
-bool loadPPM(const std::string& filepath, std::vector<Pixel>& image, int& width, int& height) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        std::cerr << "Impossible d'ouvrir le fichier PPM : " << filepath << std::endl;
-        return false;
-    }
+void OBJParser::decodeTextures()
+{
+    bool queued = false;
+    for (std::unordered_map<std::string, MTLMaterial>::const_iterator it = m_materials.begin(); it != m_materials.end(); ++it)
+        if (!it->second.texturePath.empty() && it->second.textureData.empty() && m_usedMaterials.count(it->first)) {
+            queueTexture(it->second.texturePath);
+            queued = true;
+        }
+    resolveTextures();
+    // Le .scopbin a été écrit sans ces pixels : ils vont dans le cache de textures
+    if (queued && m_useCache && !m_sourcePath.empty() && !MeshCache::storeTextures(m_sourcePath, *this))
+        std::cerr << "OBJParser: impossible d'écrire le cache " << MeshCache::textureCachePathFor(m_sourcePath) << "\n";
+}
 
-    std::string tok;
-    if (!readPpmToken(file, tok) || tok != "P3")
-    {
-        std::cerr << "Format PPM invalide. Attendu P3." << std::endl;
-        return false;
-    }
+// Range un matériau lu dans un .mtl ; s'il est déjà cité par usemtl (mtllib
+// après usemtl, ou matériau redéfini), sa texture est demandée tout de suite
+void OBJParser::addMaterial(MTLMaterial& mat)
+{
+    const std::string name = mat.name;
+    MTLMaterial& stored = (m_materials[name] = std::move(mat));
+    if (m_usedMaterials.count(name))
+        requestTexture(stored);
+}
 
-    width = 0;
-    height = 0;
-    int maxColorValue = 0;
-    if (!readPpmToken(file, tok)) return false;
-    width = std::stoi(tok);
-    if (!readPpmToken(file, tok)) return false;
-    height = std::stoi(tok);
-    if (!readPpmToken(file, tok)) return false;
-    maxColorValue = std::stoi(tok);
-    if (width <= 0 || height <= 0 || maxColorValue <= 0)
-    {
-        std::cerr << "PPM header invalide: " << filepath << std::endl;
-        return false;
-    }
+// Texture d'un matériau cité par usemtl : seules celles-ci sont lues sur le
+// disque, et comptent parmi les dépendances du cache
+void OBJParser::requestTexture(const MTLMaterial& mat)
+{
+    if (mat.texturePath.empty() || !mat.textureData.empty())
+        return;
+    m_dependencies.push_back(mat.texturePath);
+    if (!m_deferTextures)
+        queueTexture(mat.texturePath);
+}
 
-    image.clear();
-    image.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
-    for (int i = 0; i < width * height; ++i)
+void OBJParser::queueTexture(const std::string& path)
+{
+    if (!m_textureDecoder)
+        m_textureDecoder.reset(new TextureDecoder());
+    m_textureDecoder->submit(path);
+}
+
+// Attend les textures en file et les range dans les matériaux utilisés qui les citent.
+// Une texture partagée par plusieurs matériaux est déplacée dans le premier
+// puis copiée depuis celui-ci.
+void OBJParser::resolveTextures()
+{
+    if (!m_textureDecoder)
+        return;
+    m_textureDecoder->wait();
+    std::unordered_map<std::string, const MTLMaterial*> owners;
+    for (std::unordered_map<std::string, MTLMaterial>::iterator it = m_materials.begin(); it != m_materials.end(); ++it)
     {
-        int r = 0, g = 0, b = 0;
-        if (!readPpmToken(file, tok)) return false;
-        r = std::stoi(tok);
-        if (!readPpmToken(file, tok)) return false;
-        g = std::stoi(tok);
-        if (!readPpmToken(file, tok)) return false;
-        b = std::stoi(tok);
-
-        // Scale to 0..255 if maxColorValue differs
-        if (maxColorValue != 255)
+        MTLMaterial& mat = it->second;
+        if (mat.texturePath.empty() || !mat.textureData.empty() || !m_usedMaterials.count(it->first))
+            continue;
+        TextureDecoder::Image* image = m_textureDecoder->find(mat.texturePath);
+        if (!image)
+            continue;
+        if (!image->ok)
+        {
+            std::cerr << "Échec du chargement de la texture PPM : " << mat.texturePath << std::endl;
+            continue;
+        }
+        mat.textureWidth = image->width;
+        mat.textureHeight = image->height;
+        const std::unordered_map<std::string, const MTLMaterial*>::const_iterator owner = owners.find(mat.texturePath);
+        if (owner != owners.end())
+            mat.textureData = owner->second->textureData;
+        else
         {
-            r = (r * 255) / maxColorValue;
-            g = (g * 255) / maxColorValue;
-            b = (b * 255) / maxColorValue;
+            mat.textureData.swap(image->rgb);
+            owners[mat.texturePath] = &mat;
         }
-        image[i].r = r;
-        image[i].g = g;
-        image[i].b = b;
     }
-
-    return true;
+    m_textureDecoder.reset();
 }
 
-
 bool OBJParser::loadMtlFromFile(const std::string& filepath)
 {
-    std::cout << "DEBUG 1 /////////////////////////////" << std::endl;
-    std::ifstream file(filepath);
-    if (!file.is_open())
+    const bool ok = readMtl(filepath);
+    resolveTextures();
+    return ok;
+}
+
+bool OBJParser::readMtl(const std::string& filepath)
+{
+    MappedFile file;
+    if (!file.open(filepath))
     {
         std::cerr << "OBJParser: impossible d'ouvrir MTL " << filepath << "\n";
         return false;
     }
 
     const std::string baseDir = directoryOf(filepath);
+    m_dependencies.push_back(filepath);
 
     MTLMaterial current;
     bool hasCurrent = false;
-    std::string line;
-    while (std::getline(file, line))
+    const char* cur = file.begin();
+    while (cur < file.end())
     {
-        line = ltrim(line);
-        if (line.empty() || line[0] == '#')
+        const char* const eol = lineEnd(cur, file.end());
+        const char* p = skipBlanks(cur, eol);
+        cur = (eol < file.end()) ? eol + 1 : file.end();
+        if (p == eol || *p == '#')
             continue;
 
-        std::istringstream iss(line);
-        std::string key;
-        iss >> key;
+        // Mot-clé comparé en place, sans std::string par ligne
+        const char* const key = p;
+        const char* const keyEnd = tokenEnd(p, eol);
+        p = keyEnd;
 
-        if (key == "newmtl")
+        if (tokenEquals(key, keyEnd, "newmtl"))
         {
             if (hasCurrent && !current.name.empty())
-                m_materials[current.name] = current;
+                addMaterial(current);
             current = MTLMaterial{};
             hasCurrent = true;
-            iss >> current.name;
+            p = skipBlanks(p, eol);
+            current.name.assign(p, tokenEnd(p, eol));
         }
         else if (!hasCurrent)
         {
             continue;
         }
-        else if (key == "Ka")
+        else if (tokenEquals(key, keyEnd, "Ka"))
         {
-            iss >> current.Ka.x >> current.Ka.y >> current.Ka.z;
+            readVec3(p, eol, current.Ka);
         }
-        else if (key == "Kd")
+        else if (tokenEquals(key, keyEnd, "Kd"))
         {
-            iss >> current.Kd.x >> current.Kd.y >> current.Kd.z;
+            readVec3(p, eol, current.Kd);
         }
-        else if (key == "Ks")
+        else if (tokenEquals(key, keyEnd, "Ks"))
         {
-            iss >> current.Ks.x >> current.Ks.y >> current.Ks.z;
+            readVec3(p, eol, current.Ks);
         }
-        else if (key == "Ns")
+        else if (tokenEquals(key, keyEnd, "Ns"))
         {
-            iss >> current.Ns;
+            scan::nextFloat(p, eol, current.Ns);
         }
-        else if (key == "d")
+        else if (tokenEquals(key, keyEnd, "d"))
         {
-            iss >> current.d;
+            scan::nextFloat(p, eol, current.d);
         }
-        else if (key == "Tr")
+        else if (tokenEquals(key, keyEnd, "Tr"))
         {
             float tr = 0.0f;
-            iss >> tr;
+            scan::nextFloat(p, eol, tr);
             current.d = 1.0f - tr;
         }
-        else if (key == "illum")
+        else if (tokenEquals(key, keyEnd, "illum"))
         {
-            iss >> current.illum;
+            scan::nextInt(p, eol, current.illum);
         }
-        else if (key == "map_Kd")
+        else if (tokenEquals(key, keyEnd, "map_Kd"))
         {
-            std::cout << "Loading texture map_Kd for material " << current.name << "\n";
-            std::cout << "DEBUG /////////////////////////////" << std::endl;
-            
-            std::string textureFile;
-            std::getline(iss, textureFile);
-            textureFile = ltrim(textureFile);
+            const std::string textureFile = restOfLine(p, eol);
             current.map_Kd = textureFile;
 
             std::string texturePath = textureFile;
             if (!texturePath.empty() && texturePath[0] != '/')
                 texturePath = baseDir + "/" + texturePath;
+            current.texturePath = texturePath;
 
-            // Charger la texture PPM
-            std::vector<Pixel> image;
-            int width, height;
-            if (loadPPM(texturePath, image, width, height))
-            {
-                // Sauvegarder l'image dans le matériau
-                current.textureWidth = width;
-                current.textureHeight = height;
-                current.textureData = image;
-            }
-            else
-            {
-                std::cerr << "Échec du chargement de la texture PPM : " << texturePath << std::endl;
-            }
         }
     }
 
     if (hasCurrent && !current.name.empty())
-        m_materials[current.name] = current;
+        addMaterial(current);
 
     return true;
 }
@@ -258,85 +330,413 @@ int OBJParser::fixIndex(int idx, int size) const {
     return -1;
 }
 
-// Analyse un token de face (ex: "1/2/3") et retourne un ObjIndex
-OBJParser::ObjIndex OBJParser::parseFaceToken(const std::string& token) const {
-    ObjIndex idx{ -1, -1, -1 };
-
-    // Trouver les positions des '/'
-    size_t p1 = token.find('/');
-    size_t p2 = token.find('/', p1 + 1); // chercher le second '/'
+// Analyse un token de face en place ("v", "v/vt", "v//vn", "v/vt/vn"), sans allocation.
+// Les composantes absentes valent 0, que fixIndex traduit en -1 (absent).
+// Retourne false pour un token mal formé, sans lever d'exception.
+bool OBJParser::parseFaceToken(const char* begin, const char* end, ObjIndex& out) const {
+    out = ObjIndex{ 0, 0, 0 };
+    const char* p = begin;
 
-    //si pas de '/', alors c'est juste la position
-    if (p1 == std::string::npos) {
-        idx.v = std::stoi(token);
-        return idx;
-    }
-
-    // Extraire les indices
-    idx.v = std::stoi(token.substr(0, p1));
+    if (!scan::parseInt(p, end, out.v))
+        return false;
+    if (p == end)
+        return true;
+    if (*p++ != '/')
+        return false;
 
-    //Rappel : 
-    //  vt = texture coord, 
-    //  vn = normal, 
-    //  v  = vertex position
+    if (p < end && *p != '/' && !scan::parseInt(p, end, out.vt))
+        return false;
+    if (p == end)
+        return true;
+    if (*p++ != '/')
+        return false;
 
-    // Si pas de second '/', alors c'est position/uv
-    if (p2 == std::string::npos) {
-        idx.vt = std::stoi(token.substr(p1 + 1));
-    } else {
-        // position/uv/normal
-        if (p2 > p1 + 1)
-            idx.vt = std::stoi(token.substr(p1 + 1, p2 - p1 - 1));
-        if (p2 + 1 < token.size())
-            idx.vn = std::stoi(token.substr(p2 + 1));
-    }
+    if (p < end && !scan::parseInt(p, end, out.vn))
+        return false;
+    return p == end;
+}
 
-    return idx;
+// Clé de lissage d'un vertex à normale générée : sa position et la clé vn qui
+// code son groupe de lissage (ou sa face, sans lissage). Des uv différents
+// n'en changent pas : une couture de texture reste lisse.
+static uint64_t smoothingKey(int v, int vn) {
+    return ((uint64_t)(uint32_t)v << 32) | (uint32_t)vn;
 }
 
-// Récupère l'index du vertex correspondant à ObjIndex, ou le crée s'il n'existe pas
+// Récupère l'index du vertex correspondant à un coin déjà résolu, ou le crée s'il n'existe pas
 uint32_t OBJParser::getOrCreateVertex(const ObjIndex& idx) {
-    static std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> indexMap;
-
-    auto it = indexMap.find(idx);
-    if (it != indexMap.end())
-        return it->second;
+    const uint32_t newIndex = (uint32_t)m_vertices.size();
+    uint32_t vertIndex = 0;
+    if (!m_dedup.findOrInsert(idx.v, idx.vt, idx.vn, newIndex, vertIndex))
+        return vertIndex;
 
     Vertex v{};
     v.position = m_positions[idx.v];
     v.normal   = (idx.vn >= 0) ? m_normals[idx.vn] : math::Vec3{0, 0, 0};
     v.uv       = (idx.vt >= 0) ? m_uvs[idx.vt]     : math::Vec2{0, 0};
-
-    uint32_t newIndex = static_cast<uint32_t>(m_vertices.size());
     m_vertices.push_back(v);
-    indexMap[idx] = newIndex;
-
+    if (m_generateNormals)
+        m_normalKeys.push_back(idx.vn < -1 ? smoothingKey(idx.v, idx.vn) : normals::kKeep);
     return newIndex;
 }
 
+void OBJParser::addPosition(const math::Vec3& v) {
+    m_positions.push_back(v);
+    if (m_positions.size() == 1)
+    {
+        m_boundsMin = v;
+        m_boundsMax = v;
+    }
+    else
+    {
+        if (v.x < m_boundsMin.x) m_boundsMin.x = v.x;
+        if (v.y < m_boundsMin.y) m_boundsMin.y = v.y;
+        if (v.z < m_boundsMin.z) m_boundsMin.z = v.z;
+        if (v.x > m_boundsMax.x) m_boundsMax.x = v.x;
+        if (v.y > m_boundsMax.y) m_boundsMax.y = v.y;
+        if (v.z > m_boundsMax.z) m_boundsMax.z = v.z;
+    }
+}
+
+void OBJParser::useMaterial(const std::string& name) {
+    m_activeMaterial = name;
+    if (m_firstUsedMaterial.empty())
+        m_firstUsedMaterial = m_activeMaterial;
+    markMaterialUsed(name);
+}
+
+// Première citation d'un matériau : sa texture part en décodage s'il est déjà
+// connu, sinon addMaterial la demandera à la lecture de son .mtl
+void OBJParser::markMaterialUsed(const std::string& name) {
+    if (!m_usedMaterials.insert(name).second)
+        return;
+    std::unordered_map<std::string, MTLMaterial>::const_iterator it = m_materials.find(name);
+    if (it != m_materials.end())
+        requestTexture(it->second);
+}
+
+// Convertit les index OBJ d'un coin de face en index 0-based, à partir du nombre
+// de positions/uvs/normales déclarées avant la face.
+// Retourne false si le coin référence une donnée inexistante.
+bool OBJParser::resolveCorner(ObjIndex& idx, int positionCount, int uvCount, int normalCount) const {
+    idx.v  = fixIndex(idx.v,  positionCount);
+    idx.vt = fixIndex(idx.vt, uvCount);
+    idx.vn = fixIndex(idx.vn, normalCount);
+    if (idx.v < 0 || idx.v >= positionCount || idx.vt >= uvCount || idx.vn >= normalCount)
+        return false;
+    if (idx.vt < -1) idx.vt = -1;
+    if (idx.vn < -1) idx.vn = -1;
+    return true;
+}
+
+// Déduplique un coin déjà résolu en vertex final.
+// missingNormal remplace vn si le coin n'en a pas (-1 : pas de normale générée).
+uint32_t OBJParser::emitCorner(ObjIndex idx, int missingNormal) {
+    if (idx.vn < 0)
+        idx.vn = missingNormal;
+    return getOrCreateVertex(idx);
+}
+
+// Numéro dense du groupe de lissage nommé par "s" : "off" et "0" désactivent le
+// lissage (-1). slots doit contenir "" -> 0, le groupe des faces lues avant tout "s".
+int OBJParser::smoothingSlot(const std::string& arg, std::unordered_map<std::string, int>& slots) {
+    if (arg == "off" || arg == "0")
+        return -1;
+    std::unordered_map<std::string, int>::const_iterator it = slots.find(arg);
+    if (it != slots.end())
+        return it->second;
+    const int slot = (int)slots.size();
+    slots[arg] = slot;
+    return slot;
+}
+
+// Nombre d'index produits par la triangulation en éventail d'une face
+static size_t fanIndexCount(size_t cornerCount) {
+    return cornerCount >= 3 ? (cornerCount - 2) * 3 : 0;
+}
+
+// Triangulation fan : écrit fanIndexCount(count) index dans out
+void OBJParser::triangulateFan(const uint32_t* faceIndices, size_t count, uint32_t* out) {
+    for (size_t i = 1; i + 1 < count; ++i) {
+        *out++ = faceIndices[0];
+        *out++ = faceIndices[i];
+        *out++ = faceIndices[i + 1];
+    }
+}
+
+// Case de m_groups du groupe, créée à sa première apparition
+uint32_t OBJParser::groupSlot(const std::string& name) {
+    std::unordered_map<std::string, uint32_t>::const_iterator it = m_groupSlots.find(name);
+    if (it != m_groupSlots.end())
+        return it->second;
+    const uint32_t slot = (uint32_t)m_groups.size();
+    MeshGroup group;
+    group.name = name;
+    m_groups.push_back(group);
+    m_groupSlots[name] = slot;
+    return slot;
+}
+
+// Case de m_submeshes du couple (groupe, matériau), créée à sa première utilisation
+uint32_t OBJParser::submeshSlot(uint32_t group, const std::string& material) {
+    // '\n' ne peut apparaître ni dans un numéro ni dans un nom lu sur une ligne
+    const std::string key = std::to_string(group) + '\n' + material;
+    std::unordered_map<std::string, uint32_t>::const_iterator it = m_submeshSlots.find(key);
+    if (it != m_submeshSlots.end())
+        return it->second;
+    const uint32_t slot = (uint32_t)m_submeshes.size();
+    Submesh submesh;
+    submesh.material = material;
+    submesh.group = group;
+    m_submeshes.push_back(submesh);
+    m_submeshSlots[key] = slot;
+    return slot;
+}
+
+// Trie les sous-maillages (indexCount déjà compté) par groupe, puis par texture et
+// par nom ; retire les vides, calcule les plages des sous-maillages et des groupes.
+// Retourne le premier index de chaque case d'origine.
+std::vector<uint32_t> OBJParser::orderSubmeshes() {
+    std::vector<std::string> textures(m_submeshes.size());
+    std::vector<uint32_t> order;
+    for (uint32_t slot = 0; slot < m_submeshes.size(); ++slot) {
+        std::unordered_map<std::string, MTLMaterial>::const_iterator it = m_materials.find(m_submeshes[slot].material);
+        if (it != m_materials.end())
+            textures[slot] = it->second.map_Kd;
+        if (m_submeshes[slot].indexCount > 0)
+            order.push_back(slot);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        if (m_submeshes[a].group != m_submeshes[b].group)
+            return m_submeshes[a].group < m_submeshes[b].group;
+        if (textures[a] != textures[b])
+            return textures[a] < textures[b];
+        return m_submeshes[a].material < m_submeshes[b].material;
+    });
+
+    std::vector<uint32_t> firstIndex(m_submeshes.size(), 0);
+    std::vector<Submesh> sorted;
+    std::vector<MeshGroup> groups;
+    sorted.reserve(order.size());
+    uint32_t next = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        Submesh submesh = m_submeshes[order[i]];
+        // Groupes vides retirés : nouvelle numérotation dans l'ordre du tri
+        if (i == 0 || submesh.group != m_submeshes[order[i - 1]].group) {
+            MeshGroup group;
+            group.name = m_groups[submesh.group].name;
+            group.firstIndex = next;
+            group.firstSubmesh = (uint32_t)sorted.size();
+            groups.push_back(group);
+        }
+        submesh.group = (uint32_t)groups.size() - 1;
+        submesh.firstIndex = next;
+        firstIndex[order[i]] = next;
+        next += submesh.indexCount;
+        groups.back().indexCount += submesh.indexCount;
+        ++groups.back().submeshCount;
+        sorted.push_back(submesh);
+    }
+    m_submeshes.swap(sorted);
+    m_groups.swap(groups);
+    return firstIndex;
+}
+
+// Boîte englobante de chaque groupe, d'après les vertices de sa plage d'index
+void OBJParser::computeGroupBounds() {
+    for (size_t g = 0; g < m_groups.size(); ++g) {
+        MeshGroup& group = m_groups[g];
+        const uint32_t* index = m_indices.data() + group.firstIndex;
+        const uint32_t* const end = index + group.indexCount;
+        if (index == end)
+            continue;
+        group.boundsMin = m_vertices[*index].position;
+        group.boundsMax = group.boundsMin;
+        for (; index < end; ++index) {
+            const math::Vec3& p = m_vertices[*index].position;
+            if (p.x < group.boundsMin.x) group.boundsMin.x = p.x;
+            if (p.y < group.boundsMin.y) group.boundsMin.y = p.y;
+            if (p.z < group.boundsMin.z) group.boundsMin.z = p.z;
+            if (p.x > group.boundsMax.x) group.boundsMax.x = p.x;
+            if (p.y > group.boundsMax.y) group.boundsMax.y = p.y;
+            if (p.z > group.boundsMax.z) group.boundsMax.z = p.z;
+        }
+    }
+}
+
+// Octets du tas en usage dans tout le processus (0 si la libc ne le dit pas) ;
+// pendant des chargements simultanés, le pic relevé compte aussi les autres
+static size_t heapInUse() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+// Relevé aux moments où le chargement occupe le plus de mémoire (fin de lecture,
+// table de déduplication pleine, vertices construits, normales) : le pic ainsi
+// mesuré est une borne basse, proche du vrai pic tant que rien d'autre n'alloue.
+void OBJParser::notePeakHeap() {
+    const size_t inUse = heapInUse();
+    if (inUse > m_heapBase && inUse - m_heapBase > m_loadStats.peakHeapBytes)
+        m_loadStats.peakHeapBytes = inUse - m_heapBase;
+}
+
+MeshData OBJParser::takeMeshData() {
+    MeshData data;
+    data.vertices.swap(m_vertices);
+    data.indices.swap(m_indices);
+    data.submeshes.swap(m_submeshes);
+    data.groups.swap(m_groups);
+    return data;
+}
+
+std::unordered_map<std::string, MTLMaterial> OBJParser::takeMaterials() {
+    std::unordered_map<std::string, MTLMaterial> materials;
+    materials.swap(m_materials);
+    return materials;
+}
+
+// Les v/vn/vt bruts ne servent plus une fois les vertices construits
+void OBJParser::releaseAttributes() {
+    m_loadStats.positionCount = m_positions.size();
+    m_loadStats.normalCount = m_normals.size();
+    m_loadStats.uvCount = m_uvs.size();
+    std::vector<math::Vec3>().swap(m_positions);
+    std::vector<math::Vec3>().swap(m_normals);
+    std::vector<math::Vec2>().swap(m_uvs);
+}
+
+// En dessous, un thread de plus pour les normales coûte plus qu'il ne rapporte
+static const size_t kMinNormalTriangles = 64 * 1024;
+
+// Calcule les normales des vertices qui ont une clé dans m_normalKeys (voir NormalGen)
+void OBJParser::generateNormals() {
+    if (std::find_if(m_normalKeys.begin(), m_normalKeys.end(),
+            [](uint64_t key) { return key != normals::kKeep; }) != m_normalKeys.end()) {
+        size_t threads = m_threadCount;
+        if (threads == 0) {
+            threads = m_indices.size() / 3 / kMinNormalTriangles;
+            if (threads > parallel::hardwareThreads())
+                threads = parallel::hardwareThreads();
+            if (threads == 0)
+                threads = 1;
+        }
+        normals::generate(m_vertices, m_indices, m_normalKeys, (unsigned)threads);
+    }
+    std::vector<uint64_t>().swap(m_normalKeys);
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
 // Charge un fichier .obj et remplit les données de vertices et indices
 bool OBJParser::loadFromFile(const std::string& filepath) {
     clear();
+    m_sourcePath = filepath;
+
+    if (m_useCache && MeshCache::load(filepath, *this)) {
+        m_loadedFromCache = true;
+        // Pixels absents du .scopbin (décodage différé lors de son écriture)
+        MeshCache::loadTextures(filepath, *this);
+        if (!m_deferTextures)
+            decodeTextures();
+        return true;
+    }
+
+    const std::string baseDir = directoryOf(filepath);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_heapBase = heapInUse();
+    bool ok = false;
+    if (Decompressor::detectFile(filepath) != Decompressor::FORMAT_NONE)
+        ok = loadCompressed(filepath, baseDir);
+    else
+        ok = (m_reader == READER_MMAP)
+            ? loadWithMapping(filepath, baseDir)
+            : loadWithStream(filepath, baseDir);
+    m_loadStats.parseMs = elapsedMs(start);
+    if (!ok) {
+        m_textureDecoder.reset();
+        return false;
+    }
+    if (m_generateNormals) {
+        start = std::chrono::steady_clock::now();
+        generateNormals();
+        m_loadStats.normalsMs = elapsedMs(start);
+    }
+    // Les textures se décodaient pendant la lecture et les normales
+    resolveTextures();
+    if (m_useCache && !MeshCache::store(filepath, *this))
+        std::cerr << "OBJParser: impossible d'écrire le cache " << MeshCache::cachePathFor(filepath) << "\n";
+
+    // Le détail du chargement reste dans getLoadStats() : l'appelant l'affiche s'il
+    // le souhaite (les chargements du pipeline tournent en parallèle)
+    if (m_rejectedFaces > 0)
+        std::cerr << "OBJParser: " << m_rejectedFaces << " face(s) mal formée(s) ignorée(s)\n";
 
+    return true;
+}
+
+// Tampon des temporaires d'une ligne du lecteur historique
+static const size_t kLineArenaBytes = 4096;
+
+// istringstream dont le tampon est alloué comme la ligne qu'il copie
+typedef std::basic_istringstream<char, std::char_traits<char>, std::pmr::polymorphic_allocator<char> > LineStream;
+
+// Lit un flottant (un mot). Le mot est converti par scan::parseFloat plutôt que
+// par `iss >> f` : num_get de la bibliothèque standard alloue une chaîne à
+// chaque flottant, hors de portée de l'arène. Même valeur bit à bit.
+static bool readFloat(LineStream& iss, std::pmr::string& token, float& out) {
+    if (!(iss >> token))
+        return false;
+    const char* p = token.data();
+    return scan::parseFloat(p, p + token.size(), out);
+}
+
+// Lecteur historique : une ligne et un istringstream par ligne, dans une arène
+bool OBJParser::loadWithStream(const std::string& filepath, const std::string& baseDir) {
     std::ifstream file(filepath);
     if (!file.is_open()) {
         std::cerr << "OBJParser: impossible d'ouvrir " << filepath << "\n";
         return false;
     }
 
-    std::unordered_map<ObjIndex, uint32_t, ObjIndexHash> indexMap;
-    std::string line;
-	const std::string baseDir = directoryOf(filepath);
+    // Le nombre final d'attributs n'est pas connu en lecture ligne à ligne :
+    // la table utilise des clés pleine largeur.
+    m_dedup.reset(INT_MAX, INT_MAX, INT_MAX, 0);
+    InlineBuffer<ObjIndex, kInlineCorners> faceCorners;
+    InlineBuffer<uint32_t, kInlineCorners> faceIndices;
+    // Temporaires d'une ligne (la ligne, la copie de l'istringstream, les mots) :
+    // pris dans lineArena, vidée à chaque ligne. Une ligne qui tient dans
+    // lineBuffer ne touche pas au tas ; une plus longue y prend des blocs,
+    // rendus à la ligne suivante.
+    alignas(std::max_align_t) char lineBuffer[kLineArenaBytes];
+    std::pmr::monotonic_buffer_resource lineArena(lineBuffer, sizeof(lineBuffer), std::pmr::new_delete_resource());
+    // Index de chaque couple (groupe, matériau), mis bout à bout une fois le fichier lu
+    std::vector<std::vector<uint32_t> > slotIndices(1);
+    uint32_t group = groupSlot(std::string());
+    std::string material;
+    uint32_t slot = submeshSlot(group, material);
+    // Normales générées : clé vn négative, paire pour un groupe de lissage,
+    // impaire et propre à chaque face sans lissage
+    std::unordered_map<std::string, int> smoothSlots;
+    smoothSlots[std::string()] = 0;
+    int smooth = 0;
+    int flatFaces = 0;
 
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string type;
+    for (;;) {
+        lineArena.release();
+        std::pmr::string line(&lineArena);
+        if (!std::getline(file, line))
+            break;
+        LineStream iss(line);
+        std::pmr::string type(&lineArena);
         iss >> type;
 
         // TODO : 
-        // 's' pour smooth shading groups
-        // 'o' pour object name
-        // 'g' pour group name
         // 'l' pour line (non supporté ici)
         // 'p' pour point (non supporté ici)
         // '#' pour commentaire
@@ -347,33 +747,22 @@ bool OBJParser::loadFromFile(const std::string& filepath) {
         // 'f' pour faces
         // 'mtllib' pour fichier de matériaux
         // 'usemtl' pour utiliser un matériau
+        // 'o' / 'g' pour un objet / groupe nommé
+        // 's' pour un groupe de lissage (normales générées)
+        std::pmr::string token(&lineArena);
         if (type == "v") {
-            math::Vec3 v;
-            iss >> v.x >> v.y >> v.z;
-            m_positions.push_back(v);
-            if (m_positions.size() == 1)
-            {
-                m_boundsMin = v;
-                m_boundsMax = v;
-            }
-            else
-            {
-                if (v.x < m_boundsMin.x) m_boundsMin.x = v.x;
-                if (v.y < m_boundsMin.y) m_boundsMin.y = v.y;
-                if (v.z < m_boundsMin.z) m_boundsMin.z = v.z;
-                if (v.x > m_boundsMax.x) m_boundsMax.x = v.x;
-                if (v.y > m_boundsMax.y) m_boundsMax.y = v.y;
-                if (v.z > m_boundsMax.z) m_boundsMax.z = v.z;
-            }
+            math::Vec3 v{0.0f, 0.0f, 0.0f};
+            readFloat(iss, token, v.x) && readFloat(iss, token, v.y) && readFloat(iss, token, v.z);
+            addPosition(v);
         }
         else if (type == "vn") {
-            math::Vec3 n;
-            iss >> n.x >> n.y >> n.z;
+            math::Vec3 n{0.0f, 0.0f, 0.0f};
+            readFloat(iss, token, n.x) && readFloat(iss, token, n.y) && readFloat(iss, token, n.z);
             m_normals.push_back(n);
         }
         else if (type == "vt") {
-            math::Vec2 uv;
-            iss >> uv.x >> uv.y;
+            math::Vec2 uv{0.0f, 0.0f};
+            readFloat(iss, token, uv.x) && readFloat(iss, token, uv.y);
             m_uvs.push_back(uv);
 			m_hasUVs = true;
         }
@@ -382,58 +771,769 @@ bool OBJParser::loadFromFile(const std::string& filepath) {
             getline(iss, mtlFile);
             mtlFile = ltrim(mtlFile);
             if (!mtlFile.empty())
-                loadMtlFromFile(baseDir + "/" + mtlFile);
+                readMtl(baseDir + "/" + mtlFile);
         }
         else if (type == "usemtl") {
-            iss >> m_activeMaterial;
-            if (m_firstUsedMaterial.empty())
-                m_firstUsedMaterial = m_activeMaterial;
+            std::string name;
+            iss >> name;
+            useMaterial(name);
+            material = name;
+            slot = submeshSlot(group, material);
+            if (slot >= slotIndices.size())
+                slotIndices.resize(slot + 1);
+        }
+        else if (type == "o" || type == "g") {
+            std::string name;
+            getline(iss, name);
+            name = ltrim(name);
+            while (!name.empty() && scan::isBlank(name[name.size() - 1]))
+                name.erase(name.size() - 1);
+            group = groupSlot(name);
+            slot = submeshSlot(group, material);
+            if (slot >= slotIndices.size())
+                slotIndices.resize(slot + 1);
+        }
+        else if (type == "s") {
+            std::string name;
+            iss >> name;
+            smooth = smoothingSlot(name, smoothSlots);
         }
         else if (type == "f") {
-            std::vector<uint32_t> faceIndices;
-            std::string token;
-
-            while (iss >> token) {
-                ObjIndex idx = parseFaceToken(token);
-
-                idx.v  = fixIndex(idx.v,  (int)m_positions.size());
-                idx.vt = fixIndex(idx.vt, (int)m_uvs.size());
-                idx.vn = fixIndex(idx.vn, (int)m_normals.size());
-
-                auto it = indexMap.find(idx);
-                uint32_t vertIndex;
-
-                if (it != indexMap.end()) {
-                    vertIndex = it->second;
-                } else {
-                    Vertex v{};
-                    v.position = m_positions[idx.v];
-                    v.normal   = (idx.vn >= 0) ? m_normals[idx.vn] : math::Vec3{0,0,0};
-                    v.uv       = (idx.vt >= 0) ? m_uvs[idx.vt]     : math::Vec2{0,0};
-
-                    vertIndex = (uint32_t)m_vertices.size();
-                    m_vertices.push_back(v);
-                    indexMap[idx] = vertIndex;
+            // Tous les coins sont résolus avant d'en dédupliquer un seul : une face
+            // rejetée ne laisse aucun vertex derrière elle (comme la fusion mmap)
+            faceCorners.clear();
+            bool valid = true;
+            while (valid && iss >> token && token[0] != '#') {
+                ObjIndex idx;
+                valid = parseFaceToken(token.data(), token.data() + token.size(), idx)
+                    && resolveCorner(idx, (int)m_positions.size(), (int)m_uvs.size(), (int)m_normals.size());
+                faceCorners.push_back(idx);
+            }
+            if (valid) {
+                int missingNormal = -1;
+                if (m_generateNormals)
+                    missingNormal = (smooth >= 0) ? -2 - 2 * smooth : -3 - 2 * flatFaces++;
+                faceIndices.clear();
+                for (size_t k = 0; k < faceCorners.size(); ++k)
+                    faceIndices.push_back(emitCorner(faceCorners[k], missingNormal));
+                std::vector<uint32_t>& out = slotIndices[slot];
+                const size_t first = out.size();
+                out.resize(first + fanIndexCount(faceIndices.size()));
+                triangulateFan(faceIndices.data(), faceIndices.size(), out.data() + first);
+                m_submeshes[slot].indexCount += (uint32_t)(out.size() - first);
+            }
+            else
+                ++m_rejectedFaces;
+        }
+    }
+    notePeakHeap();
+    m_dedup.release();
+    releaseAttributes();
+
+    const std::vector<uint32_t> firstIndex = orderSubmeshes();
+    size_t indexCount = 0;
+    for (size_t i = 0; i < slotIndices.size(); ++i)
+        indexCount += slotIndices[i].size();
+    m_indices.resize(indexCount);
+    notePeakHeap();
+    for (size_t i = 0; i < slotIndices.size(); ++i) {
+        std::copy(slotIndices[i].begin(), slotIndices[i].end(), m_indices.begin() + firstIndex[i]);
+        std::vector<uint32_t>().swap(slotIndices[i]);
+    }
+    computeGroupBounds();
+    m_groupSlots.clear();
+    m_submeshSlots.clear();
+    return true;
+}
+
+// Taille minimale d'un morceau : en dessous, lancer un thread coûte plus qu'il ne rapporte
+static const size_t kMinChunkBytes = 512 * 1024;
+
+// Première ligne qui commence à partir de p
+static const char* nextLineStart(const char* p, const char* begin, const char* end) {
+    if (p <= begin)
+        return begin;
+    const char* eol = lineEnd(p - 1, end);
+    return eol < end ? eol + 1 : end;
+}
+
+// Type de ligne pour la passe de comptage : 'v', 'n' (vn), 't' (vt), 'f', 'e' pour
+// un événement possible (usemtl, mtllib, s, o, g : compté large) ou 0
+static char recordKind(const char* p, const char* eol) {
+    p = skipBlanks(p, eol);
+    if (p >= eol)
+        return 0;
+    if (*p == 'f')
+        return (p + 1 == eol || scan::isBlank(p[1])) ? 'f' : 0;
+    if (*p == 'u' || *p == 'm' || *p == 's' || *p == 'o' || *p == 'g')
+        return 'e';
+    if (*p != 'v')
+        return 0;
+    if (p + 1 == eol || scan::isBlank(p[1]))
+        return 'v';
+    if ((p[1] == 'n' || p[1] == 't') && (p + 2 == eol || scan::isBlank(p[2])))
+        return p[1];
+    return 0;
+}
+
+// Syntaxe du premier coin d'une ligne "f" : "v", "v/vt", "v//vn" ou "v/vt/vn"
+int OBJParser::detectFaceFormat(const char* p, const char* eol) {
+    p = skipBlanks(skipBlanks(p, eol) + 1, eol);
+    const char* tokEnd = tokenEnd(p, eol);
+    int v = 0, vt = 0, vn = 0;
+    if (!scan::parseInt(p, tokEnd, v))
+        return FACE_GENERIC;
+    if (p == tokEnd)
+        return FACE_V;
+    if (*p++ != '/')
+        return FACE_GENERIC;
+    if (p < tokEnd && *p == '/')
+        return (scan::parseInt(++p, tokEnd, vn) && p == tokEnd) ? FACE_V_VN : FACE_GENERIC;
+    if (!scan::parseInt(p, tokEnd, vt))
+        return FACE_GENERIC;
+    if (p == tokEnd)
+        return FACE_V_VT;
+    if (*p++ != '/')
+        return FACE_GENERIC;
+    return (scan::parseInt(p, tokEnd, vn) && p == tokEnd) ? FACE_V_VT_VN : FACE_GENERIC;
+}
+
+// Noyau de lecture d'un coin pour un format fixe : les champs présents sont connus à la
+// compilation, sans recherche de '/' ni test de champ optionnel par coin.
+// Retourne false si le coin ne suit pas le format (la face est alors relue en générique).
+template <int Format>
+static bool parseCornerAs(const char*& p, const char* end, int& v, int& vt, int& vn) {
+    vt = 0;
+    vn = 0;
+    if (!scan::parseInt(p, end, v))
+        return false;
+    if (Format == OBJParser::FACE_V_VT || Format == OBJParser::FACE_V_VT_VN) {
+        if (p >= end || *p != '/')
+            return false;
+        ++p;
+        if (!scan::parseInt(p, end, vt))
+            return false;
+    }
+    if (Format == OBJParser::FACE_V_VN) {
+        if (end - p < 2 || p[0] != '/' || p[1] != '/')
+            return false;
+        p += 2;
+        if (!scan::parseInt(p, end, vn))
+            return false;
+    }
+    if (Format == OBJParser::FACE_V_VT_VN) {
+        if (p >= end || *p != '/')
+            return false;
+        ++p;
+        if (!scan::parseInt(p, end, vn))
+            return false;
+    }
+    return p == end || scan::isBlank(*p);
+}
+
+// Passe de comptage : nombre de v/vn/vt du morceau, pour placer chaque morceau
+// dans les tableaux globaux avant la lecture, et format de sa première face
+void OBJParser::countChunk(ObjChunk& chunk) const {
+    const char* cur = chunk.begin;
+    while (cur < chunk.end) {
+        const char* eol = lineEnd(cur, chunk.end);
+        switch (recordKind(cur, eol)) {
+            case 'v': ++chunk.positionCount; break;
+            case 'n': ++chunk.normalCount; break;
+            case 't': ++chunk.uvCount; break;
+            case 'e':
+                ++chunk.eventCount;
+                chunk.eventBytes += (size_t)(eol - cur) + 1;
+                break;
+            case 'f': {
+                if (chunk.firstFaceFormat < 0)
+                    chunk.firstFaceFormat = detectFaceFormat(cur, eol);
+                // Mêmes jetons que parseRecords : un coin par mot jusqu'au commentaire
+                const size_t corners = textscan::countWords(tokenEnd(skipBlanks(cur, eol), eol), eol);
+                ++chunk.faceCount;
+                chunk.cornerCount += corners;
+                break;
+            }
+            default: break;
+        }
+        cur = (eol < chunk.end) ? eol + 1 : chunk.end;
+    }
+}
+
+// Lit un morceau avec le noyau du format de face du fichier ; si une face ne suit
+// pas ce format, le reste du morceau est lu avec le noyau générique.
+void OBJParser::parseChunk(ObjChunk& chunk, int faceFormat) {
+    // Coins, tailles de face et événements au compte de la passe de comptage ; le
+    // texte d'un événement tient dans sa ligne, plus un alignement par allocation
+    const size_t bytes = chunk.cornerCount * sizeof(ObjIndex) + chunk.faceCount * sizeof(uint32_t)
+        + chunk.eventCount * (sizeof(ObjEvent) + alignof(std::max_align_t)) + chunk.eventBytes
+        + 4 * alignof(std::max_align_t);
+    chunk.records.reset(new ObjChunk::Records(bytes));
+    chunk.records->corners.reserve(chunk.cornerCount);
+    chunk.records->faceSizes.reserve(chunk.faceCount);
+    chunk.records->events.reserve(chunk.eventCount);
+
+    const char* resume = chunk.begin;
+    switch (faceFormat) {
+        case FACE_V:       resume = parseRecords<FACE_V>(chunk, resume); break;
+        case FACE_V_VT:    resume = parseRecords<FACE_V_VT>(chunk, resume); break;
+        case FACE_V_VN:    resume = parseRecords<FACE_V_VN>(chunk, resume); break;
+        case FACE_V_VT_VN: resume = parseRecords<FACE_V_VT_VN>(chunk, resume); break;
+        default: break;
+    }
+    if (resume)
+        parseRecords<FACE_GENERIC>(chunk, resume);
+}
+
+// Lit les enregistrements de [from, chunk.end). Les v/vn/vt sont écrits directement à
+// leur place dans m_positions/m_normals/m_uvs (dimensionnés d'avance, plages disjointes),
+// les index de face sont résolus avec les bases globales du morceau.
+// Retourne le début de la première ligne "f" hors format (noyau spécialisé), sinon nullptr.
+template <int Format>
+const char* OBJParser::parseRecords(ObjChunk& chunk, const char* from) {
+    ObjChunk::Records& out = *chunk.records;
+    InlineBuffer<ObjIndex, kInlineCorners> faceCorners;
+    const char* cur = from;
+
+    while (cur < chunk.end) {
+        const char* line = cur;
+        const char* eol = lineEnd(cur, chunk.end);
+        const char* p = skipBlanks(cur, eol);
+        const char* typeEnd = tokenEnd(p, eol);
+        cur = (eol < chunk.end) ? eol + 1 : chunk.end;
+
+        if (p == typeEnd || *p == '#')
+            continue;
+
+        if (tokenEquals(p, typeEnd, "v")) {
+            math::Vec3 v{0.0f, 0.0f, 0.0f};
+            readVec3(typeEnd, eol, v);
+            m_positions[chunk.positionBase + chunk.positionsRead] = v;
+            if (chunk.positionsRead == 0)
+            {
+                chunk.boundsMin = v;
+                chunk.boundsMax = v;
+            }
+            else
+            {
+                if (v.x < chunk.boundsMin.x) chunk.boundsMin.x = v.x;
+                if (v.y < chunk.boundsMin.y) chunk.boundsMin.y = v.y;
+                if (v.z < chunk.boundsMin.z) chunk.boundsMin.z = v.z;
+                if (v.x > chunk.boundsMax.x) chunk.boundsMax.x = v.x;
+                if (v.y > chunk.boundsMax.y) chunk.boundsMax.y = v.y;
+                if (v.z > chunk.boundsMax.z) chunk.boundsMax.z = v.z;
+            }
+            ++chunk.positionsRead;
+        }
+        else if (tokenEquals(p, typeEnd, "vn")) {
+            math::Vec3 n{0.0f, 0.0f, 0.0f};
+            readVec3(typeEnd, eol, n);
+            m_normals[chunk.normalBase + chunk.normalsRead++] = n;
+        }
+        else if (tokenEquals(p, typeEnd, "vt")) {
+            math::Vec2 uv{0.0f, 0.0f};
+            p = typeEnd;
+            if (scan::nextFloat(p, eol, uv.x))
+                scan::nextFloat(p, eol, uv.y);
+            m_uvs[chunk.uvBase + chunk.uvsRead++] = uv;
+        }
+        else if (tokenEquals(p, typeEnd, "f")) {
+            const int positionCount = (int)(chunk.positionBase + chunk.positionsRead);
+            const int uvCount = (int)(chunk.uvBase + chunk.uvsRead);
+            const int normalCount = (int)(chunk.normalBase + chunk.normalsRead);
+            faceCorners.clear();
+            bool valid = true;
+            p = skipBlanks(typeEnd, eol);
+            while (p < eol && *p != '#') {
+                ObjIndex idx;
+                if (Format == FACE_GENERIC) {
+                    const char* tokEnd = tokenEnd(p, eol);
+                    valid = parseFaceToken(p, tokEnd, idx) && valid;
+                    p = tokEnd;
                 }
+                else if (!parseCornerAs<Format>(p, eol, idx.v, idx.vt, idx.vn))
+                    return line;
+                valid = valid && resolveCorner(idx, positionCount, uvCount, normalCount);
+                faceCorners.push_back(idx);
+                p = skipBlanks(p, eol);
+            }
+            if (valid) {
+                out.corners.insert(out.corners.end(), faceCorners.begin(), faceCorners.end());
+                out.faceSizes.push_back((uint32_t)faceCorners.size());
+            }
+            else
+                ++chunk.rejectedFaces;
+        }
+        else if (tokenEquals(p, typeEnd, "usemtl")) {
+            p = skipBlanks(typeEnd, eol);
+            ObjEvent ev{ObjEvent::USEMTL, out.faceSizes.size(), std::pmr::string(p, tokenEnd(p, eol), &out.arena)};
+            out.events.push_back(std::move(ev));
+        }
+        else if (tokenEquals(p, typeEnd, "s")) {
+            p = skipBlanks(typeEnd, eol);
+            ObjEvent ev{ObjEvent::SMOOTH, out.faceSizes.size(), std::pmr::string(p, tokenEnd(p, eol), &out.arena)};
+            out.events.push_back(std::move(ev));
+        }
+        else if (tokenEquals(p, typeEnd, "o") || tokenEquals(p, typeEnd, "g")) {
+            ObjEvent ev{ObjEvent::GROUP, out.faceSizes.size(), restOfLine(typeEnd, eol, &out.arena)};
+            out.events.push_back(std::move(ev));
+        }
+        else if (tokenEquals(p, typeEnd, "mtllib")) {
+            ObjEvent ev{ObjEvent::MTLLIB, out.faceSizes.size(), restOfLine(typeEnd, eol, &out.arena)};
+            if (!ev.arg.empty())
+                out.events.push_back(std::move(ev));
+        }
+    }
+    return nullptr;
+}
+
+// Fusion déterministe : les morceaux sont rejoués dans l'ordre du fichier, donc la
+// déduplication, les matériaux et les bornes sont identiques à une lecture séquentielle.
+// S'arrête à la première ligne qui n'est ni vide, ni commentaire, ni mtllib :
+// ces mtllib sont les premiers événements MTLLIB des morceaux, sautés à la fusion
+void OBJParser::readHeaderMtllibs(const char* p, const char* end, const std::string& baseDir) {
+    while (p < end) {
+        const char* const eol = lineEnd(p, end);
+        const char* const type = skipBlanks(p, eol);
+        p = (eol < end) ? eol + 1 : end;
+        if (type == eol || *type == '#')
+            continue;
+        const char* const typeEnd = tokenEnd(type, eol);
+        if (!tokenEquals(type, typeEnd, "mtllib"))
+            break;
+        const std::string arg = restOfLine(typeEnd, eol);
+        if (arg.empty())
+            continue;
+        readMtl(baseDir + "/" + arg);
+        ++m_headerMtllibs;
+    }
+}
 
+void OBJParser::mergeChunks(std::vector<ObjChunk>& chunks, const std::string& baseDir) {
+    bool hasBounds = false;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const ObjChunk& chunk = chunks[c];
+        if (chunk.positionCount == 0)
+            continue;
+        if (!hasBounds) {
+            m_boundsMin = chunk.boundsMin;
+            m_boundsMax = chunk.boundsMax;
+            hasBounds = true;
+            continue;
+        }
+        if (chunk.boundsMin.x < m_boundsMin.x) m_boundsMin.x = chunk.boundsMin.x;
+        if (chunk.boundsMin.y < m_boundsMin.y) m_boundsMin.y = chunk.boundsMin.y;
+        if (chunk.boundsMin.z < m_boundsMin.z) m_boundsMin.z = chunk.boundsMin.z;
+        if (chunk.boundsMax.x > m_boundsMax.x) m_boundsMax.x = chunk.boundsMax.x;
+        if (chunk.boundsMax.y > m_boundsMax.y) m_boundsMax.y = chunk.boundsMax.y;
+        if (chunk.boundsMax.z > m_boundsMax.z) m_boundsMax.z = chunk.boundsMax.z;
+    }
+    m_hasUVs = !m_uvs.empty();
+
+    // Passe 1 : rejoue mtllib/usemtl/o/g dans l'ordre du fichier et compte les index
+    // de chaque couple (groupe, matériau), pour placer chaque face directement dans
+    // sa plage. Chaque événement retient la case active après lui pour la passe 2.
+    uint32_t group = groupSlot(std::string());
+    std::string material;
+    const uint32_t firstSlot = submeshSlot(group, material);
+    uint32_t slot = firstSlot;
+    size_t cornerCount = 0;
+    // Groupes de lissage numérotés dans l'ordre du fichier, et faces sans lissage
+    // (une normale générée chacune)
+    std::unordered_map<std::string, int> smoothSlots;
+    smoothSlots[std::string()] = 0;
+    int smooth = 0;
+    size_t flatFaces = 0, flatCorners = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        ObjChunk::Records& records = *chunks[c].records;
+        const std::pmr::vector<uint32_t>& faceSizes = records.faceSizes;
+        m_rejectedFaces += chunks[c].rejectedFaces;
+        cornerCount += records.corners.size();
+        size_t nextEvent = 0;
+        for (size_t f = 0; f <= faceSizes.size(); ++f) {
+            for (; nextEvent < records.events.size() && records.events[nextEvent].faceIndex == f; ++nextEvent) {
+                ObjEvent& ev = records.events[nextEvent];
+                const std::string arg(ev.arg.begin(), ev.arg.end());
+                if (ev.type == ObjEvent::MTLLIB) {
+                    // Les mtllib d'en-tête ont déjà été lus par readHeaderMtllibs()
+                    if (m_headerMtllibs > 0)
+                        --m_headerMtllibs;
+                    else
+                        readMtl(baseDir + "/" + arg);
+                    continue;
+                }
+                if (ev.type == ObjEvent::SMOOTH) {
+                    smooth = smoothingSlot(arg, smoothSlots);
+                    ev.smooth = smooth;
+                    continue;
+                }
+                if (ev.type == ObjEvent::USEMTL) {
+                    useMaterial(arg);
+                    material = arg;
+                }
+                else
+                    group = groupSlot(arg);
+                slot = submeshSlot(group, material);
+                ev.slot = slot;
+            }
+            if (f == faceSizes.size())
+                break;
+            m_submeshes[slot].indexCount += (uint32_t)fanIndexCount(faceSizes[f]);
+            if (smooth < 0) {
+                ++flatFaces;
+                flatCorners += faceSizes[f];
+            }
+        }
+    }
+    m_groupSlots.clear();
+    m_submeshSlots.clear();
+    std::vector<uint32_t> cursor = orderSubmeshes();
+    size_t indexCount = 0;
+    for (size_t i = 0; i < m_submeshes.size(); ++i)
+        indexCount += m_submeshes[i].indexCount;
+    m_indices.resize(indexCount);
+
+    // Normales générées : un vn fictif après ceux du fichier pour chaque groupe de
+    // lissage, puis un par face sans lissage ; buildVerticesFromDedup les reconnaît
+    const size_t smoothCount = smoothSlots.size();
+    const size_t normalKeys = m_normals.size() + (m_generateNormals ? smoothCount + flatFaces : 0);
+
+    // Coins uniques <= coins de face ; en pratique proche du plus grand nombre
+    // d'attributs (plus un vertex par coin de face sans lissage). La table
+    // s'agrandit si l'estimation est dépassée.
+    size_t expected = std::max(m_positions.size(), std::max(m_uvs.size(), m_normals.size()));
+    if (m_generateNormals)
+        expected += flatCorners;
+    m_dedup.reset(m_positions.size(), m_uvs.size(), normalKeys, std::min(cornerCount, expected));
+    notePeakHeap();
+
+    // Passe 2 : les vertices ne sont construits qu'après, une fois leur nombre connu ;
+    // la table ne fait ici que numéroter les coins uniques
+    uint32_t vertexCount = 0;
+    slot = firstSlot;
+    smooth = 0;
+    int flatNormal = (int)(m_normals.size() + smoothCount);
+    InlineBuffer<uint32_t, kInlineCorners> faceIndices;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+        const ObjChunk::Records& records = *chunks[c].records;
+        const std::pmr::vector<uint32_t>& faceSizes = records.faceSizes;
+        size_t corner = 0;
+        size_t nextEvent = 0;
+        for (size_t f = 0; f <= faceSizes.size(); ++f) {
+            for (; nextEvent < records.events.size() && records.events[nextEvent].faceIndex == f; ++nextEvent) {
+                const ObjEvent& ev = records.events[nextEvent];
+                if (ev.type == ObjEvent::SMOOTH)
+                    smooth = ev.smooth;
+                else if (ev.type != ObjEvent::MTLLIB)
+                    slot = ev.slot;
+            }
+            if (f == faceSizes.size())
+                break;
+
+            int missingNormal = -1;
+            if (m_generateNormals)
+                missingNormal = (smooth >= 0) ? (int)m_normals.size() + smooth : flatNormal++;
+            faceIndices.clear();
+            for (uint32_t k = 0; k < faceSizes[f]; ++k) {
+                const ObjIndex& idx = records.corners[corner++];
+                const int vn = (idx.vn >= 0) ? idx.vn : missingNormal;
+                uint32_t vertIndex = 0;
+                if (m_dedup.findOrInsert(idx.v, idx.vt, vn, vertexCount, vertIndex))
+                    ++vertexCount;
                 faceIndices.push_back(vertIndex);
             }
+            triangulateFan(faceIndices.data(), faceIndices.size(), m_indices.data() + cursor[slot]);
+            cursor[slot] += (uint32_t)fanIndexCount(faceIndices.size());
+        }
+        // Le morceau n'est plus utile : son arène est rendue au fil de la fusion
+        chunks[c].records.reset();
+    }
+    notePeakHeap();
+    buildVerticesFromDedup();
+    notePeakHeap();
+    m_dedup.release();
+    releaseAttributes();
+    computeGroupBounds();
+}
+
+void OBJParser::buildVerticesFromDedup() {
+    m_vertices.resize(m_dedup.size());
+    if (m_generateNormals)
+        m_normalKeys.assign(m_vertices.size(), normals::kKeep);
+    const int normalCount = (int)m_normals.size();
+    m_dedup.forEach([this, normalCount](int v, int vt, int vn, uint32_t vertIndex) {
+        Vertex& out = m_vertices[vertIndex];
+        out.position = m_positions[v];
+        out.normal   = (vn >= 0 && vn < normalCount) ? m_normals[vn] : math::Vec3{0, 0, 0};
+        out.uv       = (vt >= 0) ? m_uvs[vt]     : math::Vec2{0, 0};
+        if (vn >= normalCount)
+            m_normalKeys[vertIndex] = smoothingKey(v, vn);
+    });
+}
+
+// Découpe [begin, end) en chunkCount morceaux sur des fins de ligne, ajoutés à la
+// suite de chunks, puis les compte et les lit en parallèle. Les morceaux sont placés
+// après les données déjà lues : le texte peut arriver en plusieurs plages successives.
+// faceFormat : format de la première face vue (-1 tant qu'aucune), mis à jour ici.
+void OBJParser::parseBlock(const char* begin, const char* end, size_t chunkCount,
+    std::vector<ObjChunk>& chunks, int& faceFormat) {
+    const size_t first = chunks.size();
+    chunks.resize(first + chunkCount);
+    const size_t size = (size_t)(end - begin);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        chunks[first + i].begin = nextLineStart(begin + size * i / chunkCount, begin, end);
+        chunks[first + i].end = end;
+        if (i > 0)
+            chunks[first + i - 1].end = chunks[first + i].begin;
+    }
+
+    parallel::forEachIndex(chunkCount, [&](size_t i) { countChunk(chunks[first + i]); });
+
+    // Somme préfixe : base globale de chaque morceau dans les tableaux de données brutes
+    size_t np = m_positions.size(), nn = m_normals.size(), nt = m_uvs.size();
+    for (size_t i = first; i < chunks.size(); ++i) {
+        chunks[i].positionBase = np;
+        chunks[i].normalBase = nn;
+        chunks[i].uvBase = nt;
+        np += chunks[i].positionCount;
+        nn += chunks[i].normalCount;
+        nt += chunks[i].uvCount;
+    }
+    m_positions.resize(np);
+    m_normals.resize(nn);
+    m_uvs.resize(nt);
+
+    // Format de face du fichier : celui de la première ligne "f"
+    for (size_t i = first; i < chunks.size() && faceFormat < 0; ++i)
+        faceFormat = chunks[i].firstFaceFormat;
+    const int format = faceFormat < 0 ? (int)FACE_GENERIC : faceFormat;
 
-            // Triangulation fan
-            for (size_t i = 1; i + 1 < faceIndices.size(); ++i) {
-                m_indices.push_back(faceIndices[0]);
-                m_indices.push_back(faceIndices[i]);
-                m_indices.push_back(faceIndices[i + 1]);
+    parallel::forEachIndex(chunkCount, [&](size_t i) { parseChunk(chunks[first + i], format); });
+
+    // Les usemtl lus demandent leurs textures dès maintenant : le décodage avance
+    // pendant les blocs suivants et la fusion, au lieu de démarrer en passe 1
+    std::string name;
+    for (size_t i = first; i < chunks.size(); ++i) {
+        const std::pmr::vector<ObjEvent>& events = chunks[i].records->events;
+        for (size_t e = 0; e < events.size(); ++e) {
+            if (events[e].type != ObjEvent::USEMTL)
+                continue;
+            name.assign(events[e].arg.begin(), events[e].arg.end());
+            markMaterialUsed(name);
+        }
+    }
+    notePeakHeap();
+}
+
+// Nombre de morceaux (donc de threads) pour size octets de texte
+size_t OBJParser::chunkCountFor(size_t size) const {
+    size_t chunkCount = m_threadCount;
+    if (chunkCount == 0) {
+        chunkCount = size / kMinChunkBytes;
+        if (chunkCount > parallel::hardwareThreads())
+            chunkCount = parallel::hardwareThreads();
+    }
+    return chunkCount == 0 ? 1 : chunkCount;
+}
+
+// Lecteur mmap : le fichier est parcouru comme une plage d'octets en lecture seule,
+// sans std::string ni flux par ligne. Au-delà de kMinChunkBytes, il est découpé
+// en morceaux sur des fins de ligne, lus en parallèle puis fusionnés dans l'ordre.
+bool OBJParser::loadWithMapping(const std::string& filepath, const std::string& baseDir) {
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "OBJParser: impossible d'ouvrir " << filepath << "\n";
+        return false;
+    }
+
+    readHeaderMtllibs(file.begin(), file.end(), baseDir);
+    std::vector<ObjChunk> chunks;
+    int faceFormat = -1;
+    parseBlock(file.begin(), file.end(), chunkCountFor(file.size()), chunks, faceFormat);
+    mergeChunks(chunks, baseDir);
+    return true;
+}
+
+// Taille d'un bloc de texte décompressé : assez grand pour être découpé entre les threads
+static const size_t kTextBlockBytes = 4 * 1024 * 1024;
+
+namespace {
+    // Texte décompressé, coupé après une fin de ligne (sauf en fin de fichier)
+    struct TextBlock {
+        std::vector<char> bytes; // capacité utile, agrandie pour une ligne plus longue
+        size_t size{0};
+    };
+
+    // Passage des blocs du thread de décompression au thread de lecture.
+    // Trois blocs tournent : un en lecture, un en décompression, un d'avance.
+    class TextBlockPipe {
+    public:
+        TextBlockPipe() : m_free(3), m_closed(false), m_cancelled(false), m_broken(false) {}
+
+        // Bloc libre à remplir (attend que la lecture en rende un) ; false si la
+        // lecture a abandonné
+        bool acquire(TextBlock& out) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this] { return !m_free.empty() || m_cancelled; });
+            if (m_cancelled)
+                return false;
+            std::swap(out, m_free.back());
+            m_free.pop_back();
+            return true;
+        }
+        void push(TextBlock& block) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancelled)
+                return;
+            m_full.push_back(TextBlock());
+            std::swap(m_full.back(), block);
+            m_changed.notify_all();
+        }
+        // Plus aucun bloc ne sera poussé ; broken : la décompression a échoué
+        // avant la fin du flux (mémoire épuisée)
+        void close(bool broken = false) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            m_broken = broken;
+            m_changed.notify_all();
+        }
+        // Côté lecture : plus aucun bloc ne sera lu, la décompression s'arrête
+        void cancel() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancelled = true;
+            m_changed.notify_all();
+        }
+        bool broken() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_broken;
+        }
+        // Prochain bloc plein ; false une fois le flux fermé et vidé
+        bool pop(TextBlock& out) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this] { return !m_full.empty() || m_closed; });
+            if (m_full.empty())
+                return false;
+            std::swap(out, m_full.front());
+            m_full.pop_front();
+            return true;
+        }
+        void release(TextBlock& block) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_free.push_back(TextBlock());
+            std::swap(m_free.back(), block);
+            m_changed.notify_all();
+        }
+
+    private:
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::vector<TextBlock> m_free;
+        std::deque<TextBlock> m_full;
+        bool m_closed;
+        bool m_cancelled;
+        bool m_broken;
+    };
+
+    // Abandonne le tuyau et attend le thread de décompression à toute sortie de
+    // la lecture, exception comprise : le thread n'est jamais détruit joignable
+    // ni laissé bloqué sur un bloc libre qui ne viendra plus
+    class ProducerGuard {
+    public:
+        ProducerGuard(TextBlockPipe& pipe, std::thread& thread) : m_pipe(pipe), m_thread(thread) {}
+        ~ProducerGuard() {
+            m_pipe.cancel();
+            if (m_thread.joinable())
+                m_thread.join();
+        }
+
+    private:
+        ProducerGuard(const ProducerGuard&);
+        ProducerGuard& operator=(const ProducerGuard&);
+
+        TextBlockPipe& m_pipe;
+        std::thread& m_thread;
+    };
+
+    // Remplit les blocs depuis input jusqu'à la fin du flux ; le bout de ligne qui
+    // dépasse d'un bloc est reporté au début du suivant
+    void fillBlocks(Decompressor& input, TextBlockPipe& pipe) {
+        std::vector<char> carry;
+        bool finished = false;
+        while (!finished) {
+            TextBlock block;
+            if (!pipe.acquire(block))
+                return;
+            if (block.bytes.size() < kTextBlockBytes || block.bytes.size() < carry.size() * 2)
+                block.bytes.resize(std::max(kTextBlockBytes, carry.size() * 2));
+            std::copy(carry.begin(), carry.end(), block.bytes.begin());
+            block.size = carry.size();
+            carry.clear();
+
+            for (;;) {
+                if (block.size == block.bytes.size())
+                    block.bytes.resize(block.bytes.size() * 2); // ligne plus longue qu'un bloc
+                const size_t n = input.read(block.bytes.data() + block.size, block.bytes.size() - block.size);
+                block.size += n;
+                if (n == 0) {
+                    finished = true;
+                    break;
+                }
+                if (block.size < block.bytes.size())
+                    continue;
+                const char* data = block.bytes.data();
+                const char* lastNewline = static_cast<const char*>(memrchr(data, '\n', block.size));
+                if (lastNewline) {
+                    const size_t cut = (size_t)(lastNewline - data) + 1;
+                    carry.assign(data + cut, data + block.size);
+                    block.size = cut;
+                    break;
+                }
             }
+            pipe.push(block);
+        }
+    }
+
+    void decompressBlocks(Decompressor& input, TextBlockPipe& pipe) {
+        try {
+            fillBlocks(input, pipe);
+        }
+        catch (const std::bad_alloc&) {
+            pipe.close(true);
+            return;
         }
+        pipe.close();
     }
+}
 
-    //debug
-    std::cout << "Loaded OBJ: " << filepath << "\n";
-    std::cout << "Positions: " << m_positions.size() << ", Normals: " << m_normals.size() << ", UVs: " << m_uvs.size() << "\n";
-    std::cout << "Final Vertices: " << m_vertices.size() << ", Indices: " << m_indices.size() << "\n";
-	if (!m_materials.empty())
-		std::cout << "Materials: " << m_materials.size() << ", active: " << (!m_activeMaterial.empty() ? m_activeMaterial : m_firstUsedMaterial) << "\n";
+// Fichier .obj compressé (gzip, zstd) : un thread décompresse le bloc suivant pendant
+// que le bloc courant est lu comme une plage mmap, morceaux parallèles compris.
+// Les morceaux de tous les blocs sont fusionnés à la fin, comme pour un seul fichier.
+bool OBJParser::loadCompressed(const std::string& filepath, const std::string& baseDir) {
+    Decompressor input;
+    if (!input.open(filepath))
+        return false;
 
+    std::vector<ObjChunk> chunks;
+    int faceFormat = -1;
+    TextBlockPipe pipe;
+    {
+        std::thread producer(decompressBlocks, std::ref(input), std::ref(pipe));
+        ProducerGuard guard(pipe, producer);
+        TextBlock block;
+        while (pipe.pop(block)) {
+            const char* begin = block.bytes.data();
+            if (chunks.empty())
+                readHeaderMtllibs(begin, begin + block.size, baseDir);
+            if (block.size > 0)
+                parseBlock(begin, begin + block.size, chunkCountFor(block.size), chunks, faceFormat);
+            // Les morceaux ne gardent que des données copiées : le texte peut être réutilisé
+            pipe.release(block);
+        }
+    }
+    if (input.failed() || pipe.broken()) {
+        std::cerr << "OBJParser: décompression de " << filepath << " interrompue\n";
+        return false;
+    }
+    mergeChunks(chunks, baseDir);
     return true;
 }
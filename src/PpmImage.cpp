@@ -0,0 +1,289 @@
+#include "../include/PpmImage.h"
+#include "../include/MappedFile.h"
+#include "../include/NumberScan.h"
+#include "../include/TextScan.h"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+	const int kMaxValue = 65535; // maxval le plus grand permis par le format
+
+	bool isPpmSpace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f';
+	}
+
+	// Mot PPM suivant dans [p, end) ; un mot qui commence par '#' ouvre un
+	// commentaire jusqu'a la fin de la ligne
+	bool readToken(const char*& p, const char* end, const char*& tokBegin, const char*& tokEnd)
+	{
+		for (;;)
+		{
+			p = textscan::skipSpaces(p, end);
+			if (p >= end)
+				return false;
+			if (*p == '#')
+			{
+				p = textscan::findNewline(p, end);
+				continue;
+			}
+			tokBegin = p;
+			p = textscan::findSpace(p, end);
+			tokEnd = p;
+			return true;
+		}
+	}
+
+	// Lit un mot PPM entier ; false si le mot n'est pas un nombre complet
+	bool readInt(const char*& p, const char* end, int& out)
+	{
+		const char* tokBegin = NULL;
+		const char* tokEnd = NULL;
+		if (!readToken(p, end, tokBegin, tokEnd))
+			return false;
+		return scan::parseInt(tokBegin, tokEnd, out) && tokBegin == tokEnd;
+	}
+
+	// Table de conversion [0, entries) -> [0, 255] : v * 255 / maxval (arrondi
+	// vers le bas), 255 au-dela de maxval
+	void buildScale(int maxval, std::size_t entries, std::vector<unsigned char>& lut)
+	{
+		lut.resize(entries);
+		for (std::size_t v = 0; v < entries; ++v)
+			lut[v] = static_cast<unsigned char>(v <= static_cast<std::size_t>(maxval) ? v * 255u / static_cast<unsigned>(maxval) : 255u);
+	}
+
+	// Nombre de chiffres ASCII au debut de word (8 octets lus en petit-boutiste).
+	// Un octet est un chiffre si son quartet haut vaut 3 et reste 3 apres +6
+	// (0x30..0x39) ; la retenue d'un octet non chiffre ne touche que les octets
+	// qui le suivent, jamais ceux d'avant.
+	inline unsigned leadingDigits(std::uint64_t word)
+	{
+		const std::uint64_t t = (word & 0xF0F0F0F0F0F0F0F0ULL)
+			| (((word + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4);
+		const std::uint64_t nonDigit = t ^ 0x3333333333333333ULL;
+		return nonDigit == 0 ? 8u : static_cast<unsigned>(__builtin_ctzll(nonDigit)) >> 3;
+	}
+
+	// Valeur des n premiers chiffres de word (1 <= n <= 8) : les chiffres sont
+	// pousses en haut du mot (zeros devant), puis combines par paires, quartets
+	// et octets en trois multiplications
+	inline std::uint32_t digitsValue(std::uint64_t word, unsigned n)
+	{
+		word = (word & 0x0F0F0F0F0F0F0F0FULL) << (8u * (8u - n));
+		word = (word * 10u + (word >> 8)) & 0x00FF00FF00FF00FFULL;
+		word = (word * 100u + (word >> 16)) & 0x0000FFFF0000FFFFULL;
+		word = (word * 10000u + (word >> 32)) & 0xFFFFFFFFULL;
+		return static_cast<std::uint32_t>(word);
+	}
+
+	// Nombre en tete de p, jusqu'au premier blanc ; 0 chiffre ou un autre
+	// caractere qu'un chiffre avant le blanc : false. Au-dela de top, vaut top
+	bool readSample(const char*& p, const char* end, std::uint32_t top, std::uint32_t& value)
+	{
+		unsigned n = 8;
+		value = 0;
+		if (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && end - p >= 8)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			n = leadingDigits(word);
+			if (n > 0 && n < 8)
+				value = digitsValue(word, n);
+		}
+		if (n == 8)
+		{
+			// Fin du fichier proche ou nombre de 8 chiffres et plus : un octet a la fois
+			n = 0;
+			while (p + n < end && p[n] >= '0' && p[n] <= '9')
+			{
+				value = value * 10u + static_cast<std::uint32_t>(p[n] - '0');
+				if (value > top)
+					value = top;
+				++n;
+			}
+		}
+		p += n;
+		return n > 0 && (p == end || isPpmSpace(*p));
+	}
+
+	// Composantes d'un P3, un nombre apres l'autre depuis p : fin de fichier et
+	// commentaires au milieu des pixels
+	bool decodeTextScalar(const char* p, const char* end, const std::vector<unsigned char>& lut,
+		std::size_t first, std::size_t samples, unsigned char* out, std::string& error)
+	{
+		const std::uint32_t top = static_cast<std::uint32_t>(lut.size() - 1);
+		for (std::size_t i = first; i < samples; ++i)
+		{
+			while (p < end && (isPpmSpace(*p) || *p == '#'))
+				p = (*p == '#') ? textscan::findNewline(p, end) : p + 1;
+			if (p >= end)
+			{
+				error = "donnees PPM tronquees";
+				return false;
+			}
+			std::uint32_t value = 0;
+			if (!readSample(p, end, top, value))
+			{
+				error = "composante PPM invalide";
+				return false;
+			}
+			out[i] = lut[value < top ? value : top];
+		}
+		return true;
+	}
+
+	// Composantes d'un P3 : samples nombres separes par des blancs, convertis
+	// par lut ; une valeur au-dela de top lit lut[top].
+	// Par blocs de 64 octets : textscan::classify donne le masque des blancs,
+	// d'ou les debuts de nombres (un non-blanc apres un blanc) ; chaque nombre
+	// est ensuite lu depuis son debut sans attendre la fin du precedent. Un
+	// commentaire ou la fin du fichier repasse au parcours nombre par nombre.
+	bool decodeText(const char* p, const char* end, const std::vector<unsigned char>& lut,
+		std::size_t samples, unsigned char* out, std::string& error)
+	{
+		const std::uint32_t top = static_cast<std::uint32_t>(lut.size() - 1);
+		std::size_t i = 0;
+		const char* resume = p;     // fin du dernier nombre lu
+		std::uint64_t spaceBefore = 1; // l'octet avant le bloc est un blanc
+		while (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ && i < samples && end - p >= 64 + 8)
+		{
+			textscan::BlockMasks masks;
+			textscan::classify(p, end, masks);
+			if (masks.hash != 0)
+				break;
+			std::uint64_t starts = ~masks.space & ((masks.space << 1) | spaceBefore);
+			spaceBefore = masks.space >> 63;
+			for (; starts != 0 && i < samples; starts &= starts - 1)
+			{
+				const unsigned start = static_cast<unsigned>(__builtin_ctzll(starts));
+				const char* q = p + start;
+				// Longueur du mot d'apres le masque (0 s'il deborde du bloc) : s'il
+				// n'est fait que de chiffres, rien d'autre a verifier
+				const std::uint64_t after = masks.space >> start;
+				const unsigned length = (after != 0) ? static_cast<unsigned>(__builtin_ctzll(after)) : 0u;
+				std::uint64_t word;
+				std::memcpy(&word, q, sizeof(word));
+				const unsigned n = leadingDigits(word);
+				std::uint32_t value = 0;
+				if (n == length && n != 0 && n < 8)
+				{
+					value = digitsValue(word, n);
+					q += n;
+				}
+				else if (!readSample(q, end, top, value))
+				{
+					error = "composante PPM invalide";
+					return false;
+				}
+				out[i++] = lut[value < top ? value : top];
+				resume = q;
+			}
+			p += 64;
+		}
+		return decodeTextScalar(resume, end, lut, i, samples, out, error);
+	}
+
+	// Composantes d'un P6 : un octet (maxval < 256) ou deux en gros-boutiste
+	bool decodeBinary(const char* p, const char* end, int maxval,
+		std::size_t samples, unsigned char* out, std::string& error)
+	{
+		const std::size_t bytesPerSample = (maxval < 256) ? 1u : 2u;
+		if (static_cast<std::size_t>(end - p) < samples * bytesPerSample)
+		{
+			error = "donnees PPM tronquees";
+			return false;
+		}
+		const unsigned char* in = reinterpret_cast<const unsigned char*>(p);
+		if (maxval == 255)
+		{
+			std::memcpy(out, in, samples);
+			return true;
+		}
+		std::vector<unsigned char> lut;
+		buildScale(maxval, (bytesPerSample == 1) ? 256u : 65536u, lut);
+		if (bytesPerSample == 1)
+		{
+			for (std::size_t i = 0; i < samples; ++i)
+				out[i] = lut[in[i]];
+		}
+		else
+		{
+			for (std::size_t i = 0; i < samples; ++i)
+				out[i] = lut[(static_cast<unsigned>(in[2 * i]) << 8) | in[2 * i + 1]];
+		}
+		return true;
+	}
+}
+
+bool ppm::decode(const char* data, std::size_t size, std::vector<unsigned char>& rgb,
+	int& width, int& height, std::string& error)
+{
+	const char* p = data;
+	const char* const end = data + size;
+	const char* magicBegin = NULL;
+	const char* magicEnd = NULL;
+	if (!readToken(p, end, magicBegin, magicEnd) || magicEnd - magicBegin != 2 || magicBegin[0] != 'P'
+		|| (magicBegin[1] != '3' && magicBegin[1] != '6'))
+	{
+		error = "format PPM invalide, attendu P3 ou P6";
+		return false;
+	}
+	const bool binary = (magicBegin[1] == '6');
+
+	width = 0;
+	height = 0;
+	int maxval = 0;
+	if (!readInt(p, end, width) || !readInt(p, end, height) || !readInt(p, end, maxval)
+		|| width <= 0 || height <= 0 || maxval <= 0 || maxval > kMaxValue
+		|| static_cast<std::size_t>(width) > SIZE_MAX / 3u / static_cast<std::size_t>(height))
+	{
+		error = "en-tete PPM invalide";
+		return false;
+	}
+	const std::size_t samples = static_cast<std::size_t>(width) * static_cast<std::size_t>(height) * 3u;
+
+	// Un seul blanc separe maxval des donnees binaires ; en P3, chaque
+	// composante prend au moins un octet : un en-tete qui annonce plus que le
+	// fichier ne contient est refuse avant d'allouer
+	if (binary && (p >= end || !isPpmSpace(*p)))
+	{
+		error = "en-tete PPM invalide";
+		return false;
+	}
+	if (binary)
+		++p;
+	if (static_cast<std::size_t>(end - p) < samples)
+	{
+		error = "donnees PPM tronquees";
+		return false;
+	}
+
+	rgb.clear();
+	rgb.resize(samples);
+	if (binary)
+		return decodeBinary(p, end, maxval, samples, rgb.data(), error);
+	std::vector<unsigned char> lut;
+	buildScale(maxval, static_cast<std::size_t>(maxval) + 2u, lut);
+	return decodeText(p, end, lut, samples, rgb.data(), error);
+}
+
+bool ppm::load(const std::string& path, std::vector<unsigned char>& rgb, int& width, int& height)
+{
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cerr << "Impossible d'ouvrir le fichier PPM : " << path << std::endl;
+		return false;
+	}
+	std::string error;
+	if (!decode(file.begin(), file.size(), rgb, width, height, error))
+	{
+		std::cerr << "PPM illisible (" << error << ") : " << path << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,284 @@
+#include "../include/TextScan.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <immintrin.h>
+# define TEXTSCAN_X86 1
+#endif
+
+namespace
+{
+	typedef void (*ClassifyFn)(const char* p, textscan::BlockMasks& out);
+
+	// p pointe sur 64 octets lisibles (voir textscan::classify pour les fins de plage)
+	void classifyScalar(const char* p, textscan::BlockMasks& out)
+	{
+		std::uint64_t newline = 0;
+		std::uint64_t space = 0;
+		std::uint64_t hash = 0;
+		for (unsigned i = 0; i < 64; ++i)
+		{
+			const unsigned char c = static_cast<unsigned char>(p[i]);
+			const std::uint64_t bit = 1ULL << i;
+			if (c == '\n')
+				newline |= bit;
+			if (c == ' ' || (c >= '\t' && c <= '\r'))
+				space |= bit;
+			if (c == '#')
+				hash |= bit;
+		}
+		out.newline = newline;
+		out.space = space;
+		out.hash = hash;
+	}
+
+#ifdef TEXTSCAN_X86
+	// '\t'..'\r' : c - 9 <= 4 en non signe, teste par min(c - 9, 4) == c - 9
+	__attribute__((target("sse2")))
+	void classify16(__m128i c, unsigned& newline, unsigned& space, unsigned& hash)
+	{
+		const __m128i nl = _mm_cmpeq_epi8(c, _mm_set1_epi8('\n'));
+		const __m128i ctl = _mm_sub_epi8(c, _mm_set1_epi8('\t'));
+		const __m128i isCtl = _mm_cmpeq_epi8(_mm_min_epu8(ctl, _mm_set1_epi8(4)), ctl);
+		const __m128i sp = _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(' ')), isCtl);
+		newline = static_cast<unsigned>(_mm_movemask_epi8(nl));
+		space = static_cast<unsigned>(_mm_movemask_epi8(sp));
+		hash = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8('#'))));
+	}
+
+	__attribute__((target("sse2")))
+	void classifySse2(const char* p, textscan::BlockMasks& out)
+	{
+		out.newline = 0;
+		out.space = 0;
+		out.hash = 0;
+		for (unsigned i = 0; i < 4; ++i)
+		{
+			unsigned nl, sp, h;
+			classify16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i)), nl, sp, h);
+			out.newline |= static_cast<std::uint64_t>(nl) << (16 * i);
+			out.space |= static_cast<std::uint64_t>(sp) << (16 * i);
+			out.hash |= static_cast<std::uint64_t>(h) << (16 * i);
+		}
+	}
+
+	__attribute__((target("avx2")))
+	void classify32(__m256i c, std::uint64_t& newline, std::uint64_t& space, std::uint64_t& hash)
+	{
+		const __m256i nl = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('\n'));
+		const __m256i ctl = _mm256_sub_epi8(c, _mm256_set1_epi8('\t'));
+		const __m256i isCtl = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, _mm256_set1_epi8(4)), ctl);
+		const __m256i sp = _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(' ')), isCtl);
+		newline = static_cast<std::uint32_t>(_mm256_movemask_epi8(nl));
+		space = static_cast<std::uint32_t>(_mm256_movemask_epi8(sp));
+		hash = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('#'))));
+	}
+
+	__attribute__((target("avx2")))
+	void classifyAvx2(const char* p, textscan::BlockMasks& out)
+	{
+		std::uint64_t nl0, sp0, h0, nl1, sp1, h1;
+		classify32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)), nl0, sp0, h0);
+		classify32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)), nl1, sp1, h1);
+		out.newline = nl0 | (nl1 << 32);
+		out.space = sp0 | (sp1 << 32);
+		out.hash = h0 | (h1 << 32);
+	}
+#endif
+
+	textscan::Level detectLevel()
+	{
+#ifdef TEXTSCAN_X86
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return textscan::LEVEL_AVX2;
+		if (__builtin_cpu_supports("sse2"))
+			return textscan::LEVEL_SSE2;
+#endif
+		return textscan::LEVEL_SCALAR;
+	}
+
+	ClassifyFn functionFor(textscan::Level level)
+	{
+#ifdef TEXTSCAN_X86
+		if (level == textscan::LEVEL_AVX2)
+			return classifyAvx2;
+		if (level == textscan::LEVEL_SSE2)
+			return classifySse2;
+#endif
+		(void)level;
+		return classifyScalar;
+	}
+
+	const textscan::Level g_bestLevel = detectLevel();
+	textscan::Level g_level = g_bestLevel;
+	ClassifyFn g_classify = functionFor(g_bestLevel);
+
+	const std::ptrdiff_t kShortScan = 16;
+
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || (c >= '\t' && c <= '\r');
+	}
+
+	inline unsigned lowestBit(std::uint64_t mask)
+	{
+		return static_cast<unsigned>(__builtin_ctzll(mask));
+	}
+}
+
+namespace textscan
+{
+	void classify(const char* p, const char* end, BlockMasks& out)
+	{
+		const std::size_t n = static_cast<std::size_t>(end - p);
+		if (n >= 64)
+		{
+			g_classify(p, out);
+			return;
+		}
+		// Fin de plage : lire les 64 octets en place deborderait de l'objet
+		// (std::vector, std::string) meme sans changer de page ; copie, les bits
+		// en trop sont effaces
+		const std::uint64_t valid = (1ULL << n) - 1;
+		char block[64] = {0};
+		std::memcpy(block, p, n);
+		g_classify(block, out);
+		out.newline &= valid;
+		out.space &= valid;
+		out.hash &= valid;
+	}
+
+	const char* findNewline(const char* p, const char* end)
+	{
+		if (g_level == LEVEL_SCALAR)
+		{
+			while (p < end && *p != '\n')
+				++p;
+			return p;
+		}
+		while (p < end)
+		{
+			BlockMasks m;
+			classify(p, end, m);
+			if (m.newline)
+				return p + lowestBit(m.newline);
+			if (end - p <= 64)
+				break;
+			p += 64;
+		}
+		return end;
+	}
+
+	const char* findSpace(const char* p, const char* end)
+	{
+		// Les mots sont le plus souvent courts : quelques octets testes directement
+		// coutent moins qu'un classement de bloc
+		const char* shortEnd = (end - p > kShortScan) ? p + kShortScan : end;
+		while (p < shortEnd && !isSpace(*p))
+			++p;
+		if (p < shortEnd || g_level == LEVEL_SCALAR)
+		{
+			while (p < end && !isSpace(*p))
+				++p;
+			return p;
+		}
+		while (p < end)
+		{
+			BlockMasks m;
+			classify(p, end, m);
+			if (m.space)
+				return p + lowestBit(m.space);
+			if (end - p <= 64)
+				break;
+			p += 64;
+		}
+		return end;
+	}
+
+	const char* skipSpaces(const char* p, const char* end)
+	{
+		const char* shortEnd = (end - p > kShortScan) ? p + kShortScan : end;
+		while (p < shortEnd && isSpace(*p))
+			++p;
+		if (p < shortEnd || g_level == LEVEL_SCALAR)
+		{
+			while (p < end && isSpace(*p))
+				++p;
+			return p;
+		}
+		while (p < end)
+		{
+			BlockMasks m;
+			classify(p, end, m);
+			const std::size_t n = static_cast<std::size_t>(end - p);
+			const std::uint64_t valid = n >= 64 ? ~0ULL : ((1ULL << n) - 1);
+			if (~m.space & valid)
+				return p + lowestBit(~m.space & valid);
+			if (n <= 64)
+				break;
+			p += 64;
+		}
+		return end;
+	}
+
+	std::size_t countWords(const char* p, const char* end)
+	{
+		std::size_t words = 0;
+		if (g_level == LEVEL_SCALAR)
+		{
+			p = skipSpaces(p, end);
+			while (p < end && *p != '#')
+			{
+				++words;
+				p = skipSpaces(findSpace(p, end), end);
+			}
+			return words;
+		}
+		std::uint64_t carry = 1; // l'octet avant p compte comme un blanc
+		while (p < end)
+		{
+			BlockMasks m;
+			classify(p, end, m);
+			const std::size_t n = static_cast<std::size_t>(end - p);
+			const std::uint64_t valid = n >= 64 ? ~0ULL : ((1ULL << n) - 1);
+			const std::uint64_t word = ~m.space & valid;
+			// Debut de mot : octet non blanc precede d'un blanc
+			const std::uint64_t starts = word & ((m.space << 1) | carry);
+			const std::uint64_t comment = starts & m.hash;
+			if (comment)
+				return words + static_cast<std::size_t>(__builtin_popcountll(starts & ((comment & -comment) - 1)));
+			words += static_cast<std::size_t>(__builtin_popcountll(starts));
+			if (n <= 64)
+				break;
+			carry = m.space >> 63;
+			p += 64;
+		}
+		return words;
+	}
+
+	Level activeLevel()
+	{
+		return g_level;
+	}
+
+	Level bestLevel()
+	{
+		return g_bestLevel;
+	}
+
+	bool forceLevel(Level level)
+	{
+		if (level > g_bestLevel)
+			return false;
+		g_level = level;
+		g_classify = functionFor(g_level);
+		return true;
+	}
+
+	const char* levelName(Level level)
+	{
+		return level == LEVEL_AVX2 ? "avx2" : (level == LEVEL_SSE2 ? "sse2" : "scalar");
+	}
+}
@@ -0,0 +1,79 @@
+#include "../include/TextureDecoder.h"
+#include "../include/Parallel.h"
+#include "../include/PpmImage.h"
+
+TextureDecoder::TextureDecoder(unsigned maxThreads)
+	: m_maxThreads(maxThreads != 0 ? maxThreads : parallel::hardwareThreads())
+	, m_mutex()
+	, m_wake()
+	, m_done()
+	, m_images()
+	, m_byPath()
+	, m_next(0)
+	, m_pending(0)
+	, m_stop(false)
+	, m_threads()
+{
+}
+
+TextureDecoder::~TextureDecoder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::size_t i = 0; i < m_threads.size(); ++i)
+		m_threads[i].join();
+}
+
+void TextureDecoder::submit(const std::string& path)
+{
+	bool spawn = false;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (!m_byPath.emplace(path, m_images.size()).second)
+			return;
+		m_images.push_back(Image());
+		m_images.back().path = path;
+		++m_pending;
+		// Un thread de plus tant qu'il y a plus de textures en attente que de threads
+		spawn = m_threads.size() < m_maxThreads && m_threads.size() < m_pending;
+	}
+	if (spawn)
+		m_threads.push_back(std::thread(&TextureDecoder::work, this));
+	else
+		m_wake.notify_one();
+}
+
+void TextureDecoder::wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_pending > 0)
+		m_done.wait(lock);
+}
+
+TextureDecoder::Image* TextureDecoder::find(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::unordered_map<std::string, std::size_t>::const_iterator it = m_byPath.find(path);
+	return (it != m_byPath.end()) ? &m_images[it->second] : NULL;
+}
+
+void TextureDecoder::work()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (;;)
+	{
+		while (!m_stop && m_next == m_images.size())
+			m_wake.wait(lock);
+		if (m_stop)
+			return;
+		Image& image = m_images[m_next++];
+		lock.unlock();
+		image.ok = ppm::load(image.path, image.rgb, image.width, image.height);
+		lock.lock();
+		--m_pending;
+		m_done.notify_all();
+	}
+}
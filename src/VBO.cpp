@@ -7,6 +7,11 @@ VBO::VBO(GLfloat* vertices, GLsizeiptr size)
     glBufferData(GL_ARRAY_BUFFER, size, vertices, GL_STATIC_DRAW);
 }
 
+void VBO::Update(GLintptr offset, const void* data, GLsizeiptr size)
+{
+    glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+}
+
 void VBO::Bind()
 {
     glBindBuffer(GL_ARRAY_BUFFER, ID);
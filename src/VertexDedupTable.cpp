@@ -0,0 +1,88 @@
+#include "../include/VertexDedupTable.h"
+
+// Nombre de bits pour stocker une valeur dans [0, count] (index + 1)
+static unsigned bitsFor(std::size_t count)
+{
+	unsigned bits = 1;
+	while (bits < 64 && (static_cast<std::uint64_t>(count) >> bits) != 0)
+		++bits;
+	return bits;
+}
+
+VertexDedupTable::VertexDedupTable()
+	: m_keys()
+	, m_values()
+	, m_extra()
+	, m_size(0)
+	, m_mask(0)
+	, m_vtShift(32)
+	, m_vnShift(0)
+	, m_wide(true)
+{
+	allocate(16);
+}
+
+void VertexDedupTable::reset(std::size_t positionCount, std::size_t uvCount, std::size_t normalCount,
+	std::size_t expectedEntries)
+{
+	const unsigned vBits = bitsFor(positionCount);
+	const unsigned vtBits = bitsFor(uvCount);
+	const unsigned vnBits = bitsFor(normalCount);
+	m_wide = (vBits > 32 || vtBits > 32 || vBits + vtBits + vnBits > 64);
+	m_vtShift = m_wide ? 32 : vBits;
+	m_vnShift = m_wide ? 0 : vBits + vtBits;
+
+	// Capacite : puissance de 2 qui garde expectedEntries sous le facteur de charge
+	std::size_t slots = 16;
+	while (slots / 4 * 3 < expectedEntries)
+		slots *= 2;
+	allocate(slots);
+}
+
+void VertexDedupTable::release()
+{
+	std::vector<std::uint64_t>().swap(m_keys);
+	std::vector<std::uint32_t>().swap(m_values);
+	std::vector<std::uint32_t>().swap(m_extra);
+	m_size = 0;
+	allocate(16);
+}
+
+void VertexDedupTable::allocate(std::size_t slotCount)
+{
+	m_keys.assign(slotCount, 0);
+	m_values.assign(slotCount, 0);
+	if (m_wide)
+		m_extra.assign(slotCount, 0);
+	else
+		std::vector<std::uint32_t>().swap(m_extra);
+	m_size = 0;
+	m_mask = slotCount - 1;
+}
+
+void VertexDedupTable::grow()
+{
+	std::vector<std::uint64_t> oldKeys;
+	std::vector<std::uint32_t> oldValues;
+	std::vector<std::uint32_t> oldExtra;
+	oldKeys.swap(m_keys);
+	oldValues.swap(m_values);
+	oldExtra.swap(m_extra);
+	const std::size_t count = m_size;
+
+	allocate(oldKeys.size() * 2);
+	for (std::size_t i = 0; i < oldKeys.size(); ++i)
+	{
+		if (oldKeys[i] == 0)
+			continue;
+		const std::uint32_t extra = m_wide ? oldExtra[i] : 0;
+		std::size_t slot = static_cast<std::size_t>(hashOf(oldKeys[i], extra)) & m_mask;
+		while (m_keys[slot] != 0)
+			slot = (slot + 1) & m_mask;
+		m_keys[slot] = oldKeys[i];
+		m_values[slot] = oldValues[i];
+		if (m_wide)
+			m_extra[slot] = extra;
+	}
+	m_size = count;
+}
@@ -1,18 +1,112 @@
 #include <iostream>
 
 #include <glad/glad.h>
-#include <memory>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <map>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 #include "../include/Application.h"
+#include "../include/AssetPipeline.h"
 #include "../include/Material.h"
 #include "../include/Mesh.h"
+#include "../include/MeshCache.h"
+#include "../include/ModelCache.h"
 #include "../include/OBJParser.h"
 #include "../include/shaderClass.h"
 #include <ctime>
 
+// Materiau et ses plages d'index, une par groupe qui l'utilise (voir
+// OBJParser::getSubmeshes) : un seul appel de dessin pour les groupes visibles
+struct DrawBatch
+{
+	std::vector<std::size_t> submeshes;
+	GLuint textureId; // 0 : pas de texture
+	bool hasKd;
+	math::Vec3 ka;
+	math::Vec3 kd;
+};
+
+// Un lot par materiau ; les sous-maillages arrivent tries par groupe puis par
+// texture, les lots sont tries par texture puis par nom
+static void buildBatches(const GpuModel& model, std::vector<DrawBatch>& batches)
+{
+	batches.clear();
+	const std::unordered_map<std::string, MTLMaterial>& mats = model.materials;
+	std::map<std::pair<std::string, std::string>, std::size_t> batchOf;
+	for (size_t i = 0; i < model.submeshes.size(); ++i)
+	{
+		std::unordered_map<std::string, MTLMaterial>::const_iterator it = mats.find(model.submeshes[i].material);
+		const std::string texture = (it != mats.end()) ? it->second.map_Kd : std::string();
+		const std::pair<std::string, std::string> key(texture, model.submeshes[i].material);
+		if (batchOf.find(key) == batchOf.end())
+		{
+			batchOf[key] = batches.size();
+			DrawBatch batch{};
+			batch.ka = math::Vec3{0.1f, 0.1f, 0.1f};
+			if (it != mats.end())
+			{
+				const MTLMaterial& mat = it->second;
+				batch.hasKd = true;
+				batch.ka = mat.Ka;
+				batch.kd = mat.Kd;
+				std::unordered_map<std::string, GLuint>::const_iterator tex = model.textures.find(mat.map_Kd);
+				if (!mat.map_Kd.empty() && tex != model.textures.end())
+					batch.textureId = tex->second;
+			}
+			batches.push_back(batch);
+		}
+		batches[batchOf[key]].submeshes.push_back(i);
+	}
+	std::vector<DrawBatch> sortedBatches;
+	for (std::map<std::pair<std::string, std::string>, std::size_t>::const_iterator it = batchOf.begin(); it != batchOf.end(); ++it)
+		sortedBatches.push_back(batches[it->second]);
+	batches.swap(sortedBatches);
+}
+
+// Pas une case du pipeline
+static const std::size_t kNoSlot = static_cast<std::size_t>(-1);
+// Octets envoyes au GPU par image, tous chargements confondus
+static const std::size_t kUploadBytesPerFrame = 8 * 1024 * 1024;
+// Budgets par defaut du ModelCache : modeles decodes en memoire et modeles sur
+// le GPU. SCOP_CACHE_CPU_MB et SCOP_CACHE_VRAM_MB les remplacent (en Mo, 0 : rien
+// n'est garde de ce cote)
+static const std::size_t kModelCacheCpuBytes = 256 * 1024 * 1024;
+static const std::size_t kModelCacheVramBytes = 512 * 1024 * 1024;
+// Plus gros modele prefetche (fichier, puis modele decode)
+static const std::size_t kPrefetchMaxBytes = 128 * 1024 * 1024;
+
+// Budget en octets lu dans la variable d'environnement name (en Mo) ;
+// fallback si elle est absente ou n'est pas un nombre
+static std::size_t budgetFromEnv(const char* name, std::size_t fallback)
+{
+	const char* value = std::getenv(name);
+	if (value == NULL || *value == '\0')
+		return fallback;
+	char* end = NULL;
+	errno = 0;
+	const unsigned long long megabytes = std::strtoull(value, &end, 10);
+	if (*end != '\0' || errno == ERANGE || value[0] == '-'
+		|| megabytes > static_cast<std::size_t>(-1) / (1024 * 1024))
+	{
+		std::cerr << "Ignoring " << name << "=" << value << " (expected a size in MB)\n";
+		return fallback;
+	}
+	return static_cast<std::size_t>(megabytes) * 1024 * 1024;
+}
+
+// Case du pipeline d'un chemin de la ligne de commande, kNoSlot s'il n'y est pas
+static std::size_t argvSlotOf(const std::vector<std::string>& argvPaths, const std::string& path)
+{
+	for (std::size_t i = 0; i < argvPaths.size(); ++i)
+		if (argvPaths[i] == path)
+			return i;
+	return kNoSlot;
+}
+
 int main(int argc, char** argv)
 {
 	try
@@ -24,92 +118,81 @@ int main(int argc, char** argv)
 		Shader shaderProgram("shaders/basic.vert", "shaders/basic.frag");
 		Material material(shaderProgram);
 
-		OBJParser objParser;
-		std::unique_ptr<Mesh> mesh;
-		GLuint textureId = 0;
-		bool hasTexture = false;
-		math::Vec3 kd{};
-		bool hasKd = false;
-		math::Vec3 boundsMin{};
-		math::Vec3 boundsMax{};
-		bool hasUVs = false;
-		math::Vec3 ka{0.1f, 0.1f, 0.1f};
-		std::string currentObjPath;
-
-		auto loadObjOrThrow = [&](const std::string& path) {
-			std::string actualPath = path;
-			if (actualPath.empty())
-				actualPath = "ressources/42.obj";
-			if (!objParser.loadFromFile(actualPath))
-				throw std::runtime_error("Failed to load OBJ file: " + actualPath);
-			currentObjPath = actualPath;
-			hasKd = objParser.tryGetActiveDiffuse(kd);
-			boundsMin = objParser.getBoundsMin();
-			boundsMax = objParser.getBoundsMax();
-			hasUVs = objParser.hasUVs();
-			ka = math::Vec3{0.1f, 0.1f, 0.1f};
-			if (!objParser.getActiveMaterialName().empty())
-			{
-				const std::unordered_map<std::string, MTLMaterial>& mats = objParser.getMaterials();
-				std::unordered_map<std::string, MTLMaterial>::const_iterator it = mats.find(objParser.getActiveMaterialName());
-				if (it != mats.end())
-					ka = it->second.Ka;
-			}
-			std::vector<Vertex> verticesData = objParser.getVertices();
-			const std::vector<uint32_t>& indicesData = objParser.getIndices();
-			const MTLMaterial* mat = objParser.getResolvedActiveMaterial();
-			const bool hasTexPixels = (mat && mat->textureWidth > 0 && mat->textureHeight > 0 && !mat->textureData.empty());
-
-			if (mesh)
-				mesh->Delete();
-			mesh.reset(new Mesh(verticesData, indicesData));
+		// Lecture, textures et envoi GPU en arriere-plan : la boucle continue de
+		// dessiner le modele courant jusqu'a ce que le suivant soit pret.
+		// Une case par modele de la ligne de commande, tous lus en parallele des
+		// le demarrage ; la derniere case sert aux autres fichiers (selecteur, R).
+		// Les modeles charges restent dans le ModelCache : revenir a l'un d'eux
+		// (TAB, R) ne coute rien tant qu'il est sur le GPU, et seulement l'envoi
+		// GPU tant que sa copie decodee est en memoire.
+		const std::vector<std::string>& argvPaths = app.argvObjPaths();
+		const std::size_t otherSlot = argvPaths.size();
+		ModelCache::Budgets budgets;
+		budgets.cpuBytes = budgetFromEnv("SCOP_CACHE_CPU_MB", kModelCacheCpuBytes);
+		budgets.vramBytes = budgetFromEnv("SCOP_CACHE_VRAM_MB", kModelCacheVramBytes);
+		ModelCache cache(budgets);
+		AssetPipeline::Settings settings;
+		settings.useCache = true;
+		settings.generateNormals = true;
+		AssetPipeline pipeline(argvPaths.size() + 1, settings);
+		std::vector<char> failed(argvPaths.size() + 1, 0);
+		const GpuModel noModel;
+		std::string shownPath;  // modele affiche, "" au demarrage
+		std::string wantedPath; // modele a afficher des qu'il est pret
+		// Prefetch du prochain modele de TAB : lu et decode en arriere-plan, range
+		// dans le cache sans copie GPU ; TAB n'a plus que l'envoi GPU a faire
+		std::string prefetchTried;    // derniere prediction traitee
+		std::string prefetchedPath;   // prefetch termine, pas encore demande par TAB
+		std::size_t prefetchHits = 0;   // TAB servi par un prefetch
+		std::size_t prefetchMisses = 0; // TAB vers un modele pas encore pret
+		std::vector<DrawBatch> batches;
+		int soloGroup = -1; // -1 : tous les groupes
+		std::vector<char> groupVisible;
+		std::vector<GLsizei> rangeFirsts;
+		std::vector<GLsizei> rangeCounts;
 
-			// (Re)build texture from MTLMaterial::textureData (PPM pixels)
-			if (textureId != 0)
-			{
-				glDeleteTextures(1, &textureId);
-				textureId = 0;
-			}
-			hasTexture = false;
-			if (hasTexPixels)
-			{
-				const int w = mat->textureWidth;
-				const int h = mat->textureHeight;
-				const size_t expected = static_cast<size_t>(w) * static_cast<size_t>(h);
-				if (mat->textureData.size() >= expected)
-				{
-					std::vector<unsigned char> rgb;
-					rgb.resize(expected * 3u);
-					for (size_t i = 0; i < expected; ++i)
-					{
-						const Pixel& p = mat->textureData[i];
-						rgb[i * 3u + 0u] = static_cast<unsigned char>(p.r < 0 ? 0 : (p.r > 255 ? 255 : p.r));
-						rgb[i * 3u + 1u] = static_cast<unsigned char>(p.g < 0 ? 0 : (p.g > 255 ? 255 : p.g));
-						rgb[i * 3u + 2u] = static_cast<unsigned char>(p.b < 0 ? 0 : (p.b > 255 ? 255 : p.b));
-					}
-
-					glGenTextures(1, &textureId);
-					glBindTexture(GL_TEXTURE_2D, textureId);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-					glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-					glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, w, h, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
-					glGenerateMipmap(GL_TEXTURE_2D);
-					glBindTexture(GL_TEXTURE_2D, 0);
-					hasTexture = true;
-				}
-			}
+		// Copie decodee gardee apres l'envoi seulement si elle tient dans ce qui
+		// reste du budget CPU du cache ; les autres modeles ne restent que sur le GPU
+		auto keepWhatFits = [&]()
+		{
+			pipeline.setKeepDecodedBytes(cache.cpuBytes() < budgets.cpuBytes ? budgets.cpuBytes - cache.cpuBytes() : 0);
+		};
+		// Affiche un modele du cache deja envoye au GPU
+		auto show = [&](const std::string& path)
+		{
+			if (!shownPath.empty() && shownPath != path)
+				std::cout << "Now displaying: " << path << "\n";
+			shownPath = path;
+			cache.setPinned(path);
+			buildBatches(*cache.find(path), batches);
+			soloGroup = -1;
+		};
+		// Affiche path depuis le cache, ou le fait charger dans slot
+		auto open = [&](std::size_t slot, const std::string& path)
+		{
+			wantedPath = path;
+			std::shared_ptr<DecodedModel> decoded;
+			if (cache.lookup(path, decoded))
+				show(path);
+			else if (decoded)
+				pipeline.upload(slot, path, decoded);
+			else if (slot == otherSlot || !pipeline.isLoading(slot))
+				pipeline.request(slot, path);
 		};
 
 		const std::string defaultObj = "ressources/42.obj";
-		if (!app.argvObjPaths().empty())	loadObjOrThrow(app.argvObjPaths()[0]);
+		if (!argvPaths.empty())
+		{
+			for (std::size_t i = 0; i < argvPaths.size(); ++i)
+				pipeline.request(i, argvPaths[i]);
+			wantedPath = argvPaths[0];
+		}
 		else
 		{
-			loadObjOrThrow(defaultObj);
+			open(otherSlot, defaultObj);
 			std::cout << "Tip: pass .obj paths: ./scop a.obj b.obj\n";
 			std::cout << "Tip: TAB opens file picker (needs zenity).\n";
+			std::cout << "Tip: SCOP_CACHE_CPU_MB / SCOP_CACHE_VRAM_MB set the model cache budgets.\n";
 		}
 
 		const math::Mat4 model = math::identity();
@@ -120,15 +203,84 @@ int main(int argc, char** argv)
 			if (app.hasPendingObjPath())
 			{
 				const std::string nextPath = app.consumePendingObjPath();
-				try
+				const std::size_t slot = argvSlotOf(argvPaths, nextPath);
+				if (slot == kNoSlot)
+					open(otherSlot, nextPath.empty() ? defaultObj : nextPath);
+				else if (failed[slot])
+					std::cout << "Skipping (failed to load): " << nextPath << "\n";
+				else
 				{
-					loadObjOrThrow(nextPath);
-					std::cout << "Now displaying: " << currentObjPath << "\n";
+					const bool ready = cache.contains(nextPath);
+					if (ready && nextPath == prefetchedPath)
+						++prefetchHits;
+					else if (!ready)
+						++prefetchMisses;
+					prefetchedPath.clear();
+					open(slot, nextPath);
 				}
-				catch (const std::exception& e)
+			}
+
+			std::size_t uploadBudget = kUploadBytesPerFrame;
+			AssetPipeline::Completion done;
+			keepWhatFits();
+			while (uploadBudget > 0 && pipeline.pump(uploadBudget, done))
+			{
+				if (!done.ok)
 				{
-					std::cerr << e.what() << "\n";
+					failed[done.slot] = 1;
+					if (done.path != wantedPath)
+						continue;
+					// Sans modele a afficher, un echec au demarrage reste fatal
+					if (shownPath.empty())
+						throw std::runtime_error("Failed to load OBJ file: " + done.path);
+					wantedPath = shownPath;
+					continue;
 				}
+				failed[done.slot] = 0;
+				if (done.prefetched)
+				{
+					if (done.path != wantedPath && done.decoded->byteSize() > kPrefetchMaxBytes)
+						continue;
+					cache.insert(done.path, done.model, done.decoded);
+					keepWhatFits();
+					if (done.path == wantedPath)
+						open(done.slot, done.path); // TAB arrive pendant le prefetch
+					else
+						prefetchedPath = done.path;
+					continue;
+				}
+				cache.insert(done.path, done.model, done.decoded);
+				keepWhatFits();
+				if (done.path == wantedPath)
+					show(done.path);
+				else if (done.path == shownPath)
+					buildBatches(*cache.find(shownPath), batches); // recharge pendant qu'on en attend un autre
+			}
+
+			// Rien en attente : prepare le modele du prochain TAB s'il n'est plus en cache
+			const std::string nextPath = app.nextArgvObjPath();
+			if (wantedPath == shownPath && !nextPath.empty() && nextPath != prefetchTried)
+			{
+				prefetchTried = nextPath;
+				const std::size_t slot = argvSlotOf(argvPaths, nextPath);
+				std::uint64_t fileSize = 0;
+				std::int64_t mtimeNs = 0;
+				if (!failed[slot] && !cache.contains(nextPath) && !pipeline.isLoading(slot)
+					&& MeshCache::statFile(nextPath, fileSize, mtimeNs) && fileSize <= kPrefetchMaxBytes)
+					pipeline.prefetch(slot, nextPath);
+			}
+
+			const GpuModel* shownModel = shownPath.empty() ? NULL : cache.find(shownPath);
+			const GpuModel& current = shownModel ? *shownModel : noModel;
+
+			const int groupSteps = app.consumeGroupSteps();
+			const std::vector<MeshGroup>& groups = current.groups;
+			if (groupSteps > 0 && !groups.empty())
+			{
+				// -1, 0, 1, ..., n - 1, -1, ...
+				const int cycle = static_cast<int>(groups.size()) + 1;
+				soloGroup = (soloGroup + 1 + groupSteps) % cycle - 1;
+				std::cout << "Showing group: " << (soloGroup < 0 ? std::string("(all)") : groups[soloGroup].name) << "\n";
 			}
 
 			const float now = app.time();
@@ -164,51 +316,80 @@ int main(int argc, char** argv)
 
 			material.setFloat("scale", 0.5f);
 			material.setInt("uUseGradient", 1);
-			material.setInt("uGradientUseUV", hasUVs ? 1 : 0);
-			const int useTexture = (hasTexture && hasUVs && textureId != 0) ? 1 : 0;
-			material.setInt("uUseTexture", useTexture);
-			if (useTexture)
-			{
-				// UV transform controls (identity by default). If texture doesn't align, try uUvMode=1/2/4/5/6/7.
-				material.setInt("uUvMode", 0);
-				material.setVec2("uUvScale", 1.0f, 1.0f);
-				material.setVec2("uUvOffset", 0.0f, 0.0f);
-
-				glActiveTexture(GL_TEXTURE0);
-				glBindTexture(GL_TEXTURE_2D, textureId);
-				material.setInt("uTexture", 0);
-				material.setInt("uUvMode", 2);
-			}
-			material.setFloat("uMinY", boundsMin.y);
-			material.setFloat("uMaxY", boundsMax.y);
-			if (hasKd)
-			{
-				material.setVec3("uColorA", ka.x, ka.y, ka.z);
-				material.setVec3("uColorB", kd.x, kd.y, kd.z);
-			}
-			else
-			{
-				material.setVec3("uColorA", 0.10f, 0.20f, 0.60f);
-				material.setVec3("uColorB", 0.90f, 0.40f, 0.10f);
-			}
+			material.setInt("uGradientUseUV", current.hasUVs ? 1 : 0);
+			// UV transform controls. If texture doesn't align, try uUvMode=0/1/4/5/6/7.
+			material.setInt("uUvMode", 2);
+			material.setVec2("uUvScale", 1.0f, 1.0f);
+			material.setVec2("uUvOffset", 0.0f, 0.0f);
+			material.setInt("uTexture", 0);
+			material.setFloat("uMinY", current.boundsMin.y);
+			material.setFloat("uMaxY", current.boundsMax.y);
 			material.setVec3("uColor", 1.0f, 1.0f, 1.0f);
 			material.setMat4("uModel", model);
 			material.setMat4("uView", app.camera().getViewMatrix());
 			material.setMat4("uProjection", app.camera().getProjectionMatrix());
 
-			if (mesh)
-				mesh->Draw();
-			if (useTexture)
-				glBindTexture(GL_TEXTURE_2D, 0);
+			// Groupes masques (G) ou hors du champ de la camera : leurs plages sont sautees
+			const math::Mat4 viewProj = math::mul(app.camera().getProjectionMatrix(),
+				math::mul(app.camera().getViewMatrix(), model));
+			groupVisible.assign(groups.size(), 0);
+			for (size_t g = 0; g < groups.size(); ++g)
+				groupVisible[g] = (soloGroup < 0 || static_cast<size_t>(soloGroup) == g)
+					&& math::aabbInFrustum(viewProj, groups[g].boundsMin, groups[g].boundsMax);
+
+			// Les uniforms et la texture ne changent qu'entre lots differents
+			glActiveTexture(GL_TEXTURE0);
+			const DrawBatch* previous = NULL;
+			for (size_t i = 0; current.mesh && i < batches.size(); ++i)
+			{
+				const DrawBatch& batch = batches[i];
+				rangeFirsts.clear();
+				rangeCounts.clear();
+				for (size_t k = 0; k < batch.submeshes.size(); ++k)
+				{
+					const Submesh& submesh = current.submeshes[batch.submeshes[k]];
+					if (!groupVisible[submesh.group])
+						continue;
+					rangeFirsts.push_back(static_cast<GLsizei>(submesh.firstIndex));
+					rangeCounts.push_back(static_cast<GLsizei>(submesh.indexCount));
+				}
+				if (rangeCounts.empty())
+					continue;
+
+				const int useTexture = (batch.textureId != 0 && current.hasUVs) ? 1 : 0;
+				if (!previous || batch.textureId != previous->textureId)
+				{
+					glBindTexture(GL_TEXTURE_2D, batch.textureId);
+					material.setInt("uUseTexture", useTexture);
+				}
+				if (!previous || batch.hasKd != previous->hasKd
+					|| std::memcmp(&batch.ka, &previous->ka, sizeof(batch.ka)) != 0
+					|| std::memcmp(&batch.kd, &previous->kd, sizeof(batch.kd)) != 0)
+				{
+					if (batch.hasKd)
+					{
+						material.setVec3("uColorA", batch.ka.x, batch.ka.y, batch.ka.z);
+						material.setVec3("uColorB", batch.kd.x, batch.kd.y, batch.kd.z);
+					}
+					else
+					{
+						material.setVec3("uColorA", 0.10f, 0.20f, 0.60f);
+						material.setVec3("uColorB", 0.90f, 0.40f, 0.10f);
+					}
+				}
+				current.mesh->DrawRanges(rangeFirsts.data(), rangeCounts.data(), static_cast<GLsizei>(rangeCounts.size()));
+				previous = &batch;
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
 
 			app.swapBuffers();
 			app.pollEvents();
 		}
 
-		if (mesh)
-			mesh->Delete();
-		if (textureId != 0)
-			glDeleteTextures(1, &textureId);
+		const ModelCache::Stats& stats = cache.stats();
+		std::cout << "Model cache: " << stats.gpuHits << " GPU hits, " << stats.cpuHits << " CPU hits, "
+			<< stats.misses << " misses, " << stats.gpuEvictions << " GPU / " << stats.cpuEvictions << " CPU evictions\n";
+		std::cout << "Prefetch: " << prefetchHits << " hits, " << prefetchMisses << " misses\n";
 		shaderProgram.Delete();
 		return 0;
 	}
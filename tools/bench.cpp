@@ -0,0 +1,484 @@
+// Mesure du debit du parser, sans fenetre ni contexte GL.
+//
+//   scop_bench [options] [fichier|dossier ...]     (defaut : ressources)
+//
+//   --warmup N   chargements non mesures avant les mesures (defaut 1)
+//   --reps N     chargements mesures par fichier (defaut 5)
+//   --threads N  threads du lecteur mmap (defaut 0 : automatique)
+//   --stream     lecteur std::getline au lieu du lecteur mmap
+//   --normals    genere les normales manquantes
+//   --cache      passe par le cache .scopbin (mesure alors la relecture du cache)
+//   --simd L     classement des blocs de texte impose : scalar, sse2 ou avx2
+//                (defaut : le meilleur que le processeur permet)
+//   --scalar     meme chose que --simd scalar
+//   --seam       genere les normales, puis verifie que les vertices d'une meme
+//                position ont la meme normale (fichier a un seul groupe lisse,
+//                comme ressources/seam.obj : `make seam`) ; code de sortie 1 sinon
+//
+// Les dossiers sont parcourus recursivement : chaque .obj (.obj.gz, .obj.zst)
+// passe par OBJParser::loadFromFile, chaque .mtl par loadMtlFromFile (textures
+// non decodees, elles sont mesurees a part) et chaque .ppm par ppm::load.
+// Le resultat est un objet JSON sur la sortie standard ; les messages du parser
+// sont ecartes pendant les mesures. Un fichier illisible est rapporte avec
+// "ok": false sans interrompre les autres.
+//
+// Par fichier : temps min / median / moyen, debits calcules sur le median (Mo/s
+// du fichier sur disque, vertices/s et faces/s pour un .obj, faces comptees apres
+// triangulation), OBJParser::LoadStats du dernier chargement d'un .obj, allocations et octets alloues par chargement, et pic de memoire
+// residente pendant les mesures du fichier (VmHWM remis a zero avant chaque
+// fichier quand le noyau le permet, sinon pic du processus depuis le debut).
+
+#include "../include/OBJParser.h"
+#include "../include/PpmImage.h"
+#include "../include/TextScan.h"
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// ================= Comptage des allocations =================
+
+namespace
+{
+	std::atomic<unsigned long long> g_allocCount(0);
+	std::atomic<unsigned long long> g_allocBytes(0);
+
+	void* countedAlloc(std::size_t size, std::size_t alignment = 0)
+	{
+		g_allocCount.fetch_add(1, std::memory_order_relaxed);
+		g_allocBytes.fetch_add(size, std::memory_order_relaxed);
+		if (size == 0)
+			size = 1;
+		// aligned_alloc veut une taille multiple de l'alignement
+		void* p = (alignment > alignof(std::max_align_t))
+			? std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)
+			: std::malloc(size);
+		if (p == NULL)
+			throw std::bad_alloc();
+		return p;
+	}
+}
+
+// Les variantes alignees servent aussi aux arenes std::pmr (new_delete_resource)
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void* operator new(std::size_t size, std::align_val_t a) { return countedAlloc(size, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t size, std::align_val_t a) { return countedAlloc(size, static_cast<std::size_t>(a)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+// ================= Outils =================
+
+namespace
+{
+	enum Kind
+	{
+		KIND_OBJ,
+		KIND_MTL,
+		KIND_PPM
+	};
+
+	struct Options
+	{
+		int warmup{1};
+		int reps{5};
+		unsigned threads{0};
+		bool stream{false};
+		bool normals{false};
+		bool cache{false};
+		bool seam{false};
+		textscan::Level simd{textscan::bestLevel()};
+		std::vector<std::string> paths;
+	};
+
+	struct Asset
+	{
+		std::string path;
+		Kind kind;
+		std::size_t bytes;
+	};
+
+	// Ce que rapporte un chargement, pour les debits
+	struct Work
+	{
+		bool ok{false};
+		std::size_t vertices{0};
+		std::size_t faces{0};
+		std::size_t materials{0};
+		std::size_t pixels{0};
+		OBJParser::LoadStats stats; // OBJ : detail du dernier chargement
+	};
+
+	// Tampon qui avale tout : remplace celui de std::cout pendant les mesures
+	class NullBuffer : public std::streambuf
+	{
+		protected:
+			int overflow(int c) { return c == EOF ? 0 : c; }
+			std::streamsize xsputn(const char*, std::streamsize n) { return n; }
+	};
+
+	bool endsWith(const std::string& s, const char* suffix)
+	{
+		const std::size_t n = std::strlen(suffix);
+		return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+	}
+
+	bool kindOf(const std::string& path, Kind& kind)
+	{
+		if (endsWith(path, ".obj") || endsWith(path, ".obj.gz") || endsWith(path, ".obj.zst"))
+			kind = KIND_OBJ;
+		else if (endsWith(path, ".mtl"))
+			kind = KIND_MTL;
+		else if (endsWith(path, ".ppm"))
+			kind = KIND_PPM;
+		else
+			return false;
+		return true;
+	}
+
+	void collect(const std::string& path, bool explicitFile, std::vector<Asset>& out)
+	{
+		struct stat st;
+		if (stat(path.c_str(), &st) != 0)
+		{
+			std::cerr << "scop_bench: introuvable : " << path << "\n";
+			return;
+		}
+		if (S_ISDIR(st.st_mode))
+		{
+			DIR* dir = opendir(path.c_str());
+			if (dir == NULL)
+				return;
+			std::vector<std::string> names;
+			while (struct dirent* entry = readdir(dir))
+				if (entry->d_name[0] != '.')
+					names.push_back(entry->d_name);
+			closedir(dir);
+			std::sort(names.begin(), names.end());
+			for (std::size_t i = 0; i < names.size(); ++i)
+				collect(path + "/" + names[i], false, out);
+			return;
+		}
+		Asset asset;
+		if (!kindOf(path, asset.kind))
+		{
+			if (explicitFile)
+				std::cerr << "scop_bench: type de fichier inconnu : " << path << "\n";
+			return;
+		}
+		asset.path = path;
+		asset.bytes = static_cast<std::size_t>(st.st_size);
+		out.push_back(asset);
+	}
+
+	Work runOnce(const Asset& asset, const Options& options)
+	{
+		Work work;
+		if (asset.kind == KIND_OBJ)
+		{
+			OBJParser parser;
+			parser.setReader(options.stream ? OBJParser::READER_STREAM : OBJParser::READER_MMAP);
+			parser.setThreadCount(options.threads);
+			parser.setGenerateNormals(options.normals);
+			parser.setUseCache(options.cache);
+			work.ok = parser.loadFromFile(asset.path);
+			work.vertices = parser.getVertices().size();
+			work.faces = parser.getIndices().size() / 3;
+			work.materials = parser.getMaterials().size();
+			work.stats = parser.getLoadStats();
+		}
+		else if (asset.kind == KIND_MTL)
+		{
+			OBJParser parser;
+			parser.setDeferTextureDecode(true);
+			work.ok = parser.loadMtlFromFile(asset.path);
+			work.materials = parser.getMaterials().size();
+		}
+		else
+		{
+			std::vector<unsigned char> image;
+			int width = 0, height = 0;
+			work.ok = ppm::load(asset.path, image, width, height);
+			work.pixels = image.size() / 3u;
+		}
+		return work;
+	}
+
+	// --seam : chargement a part, hors mesures. shared : positions portees par
+	// plusieurs vertices (couture de uv), split : celles dont les normales different
+	bool checkSeam(const Asset& asset, const Options& options, std::size_t& shared, std::size_t& split)
+	{
+		shared = 0;
+		split = 0;
+		OBJParser parser;
+		parser.setReader(options.stream ? OBJParser::READER_STREAM : OBJParser::READER_MMAP);
+		parser.setThreadCount(options.threads);
+		parser.setGenerateNormals(true);
+		if (!parser.loadFromFile(asset.path))
+			return false;
+		const std::vector<Vertex>& vertices = parser.getVertices();
+		std::vector<std::uint32_t> order(vertices.size());
+		for (std::size_t i = 0; i < order.size(); ++i)
+			order[i] = static_cast<std::uint32_t>(i);
+		const auto samePosition = [&vertices](std::uint32_t a, std::uint32_t b) {
+			const math::Vec3& p = vertices[a].position;
+			const math::Vec3& q = vertices[b].position;
+			return p.x == q.x && p.y == q.y && p.z == q.z;
+		};
+		std::sort(order.begin(), order.end(), [&vertices](std::uint32_t a, std::uint32_t b) {
+			const math::Vec3& p = vertices[a].position;
+			const math::Vec3& q = vertices[b].position;
+			return p.x < q.x || (p.x == q.x && (p.y < q.y || (p.y == q.y && p.z < q.z)));
+		});
+		for (std::size_t begin = 0; begin < order.size();)
+		{
+			std::size_t end = begin + 1;
+			while (end < order.size() && samePosition(order[begin], order[end]))
+				++end;
+			if (end - begin > 1)
+			{
+				++shared;
+				const math::Vec3& n = vertices[order[begin]].normal;
+				for (std::size_t i = begin + 1; i < end; ++i)
+				{
+					const math::Vec3& m = vertices[order[i]].normal;
+					if (std::fabs(n.x - m.x) > 1e-6f || std::fabs(n.y - m.y) > 1e-6f || std::fabs(n.z - m.z) > 1e-6f)
+					{
+						++split;
+						break;
+					}
+				}
+			}
+			begin = end;
+		}
+		return true;
+	}
+
+	// Remet a zero le pic de memoire residente (VmHWM) ; false si le noyau refuse
+	bool resetPeakRss()
+	{
+		std::ofstream refs("/proc/self/clear_refs");
+		if (!refs)
+			return false;
+		refs << "5";
+		return static_cast<bool>(refs.flush());
+	}
+
+	long peakRssKb()
+	{
+		std::ifstream status("/proc/self/status");
+		std::string line;
+		while (std::getline(status, line))
+			if (line.compare(0, 6, "VmHWM:") == 0)
+				return std::atol(line.c_str() + 6);
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return usage.ru_maxrss;
+	}
+
+	// Chemin en chaine JSON
+	std::string quoted(const std::string& s)
+	{
+		std::string out = "\"";
+		for (std::size_t i = 0; i < s.size(); ++i)
+		{
+			const unsigned char c = static_cast<unsigned char>(s[i]);
+			if (c == '"' || c == '\\')
+			{
+				out += '\\';
+				out += static_cast<char>(c);
+			}
+			else if (c < 0x20)
+			{
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out += escaped;
+			}
+			else
+				out += static_cast<char>(c);
+		}
+		return out + "\"";
+	}
+
+	const char* kindName(Kind kind)
+	{
+		return kind == KIND_OBJ ? "obj" : (kind == KIND_MTL ? "mtl" : "ppm");
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+			if (arg == "--warmup" && hasValue)
+				options.warmup = std::atoi(argv[++i]);
+			else if (arg == "--reps" && hasValue)
+				options.reps = std::atoi(argv[++i]);
+			else if (arg == "--threads" && hasValue)
+				options.threads = static_cast<unsigned>(std::atoi(argv[++i]));
+			else if (arg == "--stream")
+				options.stream = true;
+			else if (arg == "--normals")
+				options.normals = true;
+			else if (arg == "--cache")
+				options.cache = true;
+			else if (arg == "--seam")
+			{
+				options.seam = true;
+				options.normals = true;
+			}
+			else if (arg == "--scalar")
+				options.simd = textscan::LEVEL_SCALAR;
+			else if (arg == "--simd" && hasValue)
+			{
+				const std::string level = argv[++i];
+				if (level == "scalar")
+					options.simd = textscan::LEVEL_SCALAR;
+				else if (level == "sse2")
+					options.simd = textscan::LEVEL_SSE2;
+				else if (level == "avx2")
+					options.simd = textscan::LEVEL_AVX2;
+				else
+				{
+					std::cerr << "scop_bench: --simd attend scalar, sse2 ou avx2 : " << level << "\n";
+					return false;
+				}
+			}
+			else if (arg.compare(0, 2, "--") == 0)
+			{
+				std::cerr << "scop_bench: option inconnue ou incomplete : " << arg << "\n";
+				return false;
+			}
+			else
+				options.paths.push_back(arg);
+		}
+		if (options.warmup < 0)
+			options.warmup = 0;
+		if (options.reps < 1)
+			options.reps = 1;
+		if (options.paths.empty())
+			options.paths.push_back("ressources");
+		return true;
+	}
+}
+
+// ================= Mesures =================
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+		return 2;
+	if (!textscan::forceLevel(options.simd))
+	{
+		std::cerr << "scop_bench: " << textscan::levelName(options.simd) << " non disponible sur ce processeur\n";
+		return 2;
+	}
+
+	std::vector<Asset> assets;
+	for (std::size_t i = 0; i < options.paths.size(); ++i)
+		collect(options.paths[i], true, assets);
+	if (assets.empty())
+	{
+		std::cerr << "scop_bench: aucun fichier .obj / .mtl / .ppm a mesurer\n";
+		return 1;
+	}
+
+	std::printf("{\n  \"config\": {\"warmup\": %d, \"reps\": %d, \"threads\": %u, \"reader\": \"%s\", "
+		"\"normals\": %s, \"cache\": %s, \"simd\": \"%s\"},\n  \"results\": [",
+		options.warmup, options.reps, options.threads, options.stream ? "stream" : "mmap",
+		options.normals ? "true" : "false", options.cache ? "true" : "false",
+		textscan::levelName(textscan::activeLevel()));
+	std::fflush(stdout);
+
+	NullBuffer silence;
+	bool seamSplit = false;
+	for (std::size_t a = 0; a < assets.size(); ++a)
+	{
+		const Asset& asset = assets[a];
+		std::cerr << "scop_bench: " << asset.path << "\n";
+		const bool peakReset = resetPeakRss();
+
+		std::streambuf* const console = std::cout.rdbuf(&silence);
+		Work work;
+		for (int i = 0; i < options.warmup; ++i)
+			work = runOnce(asset, options);
+
+		std::vector<double> times;
+		const unsigned long long allocsBefore = g_allocCount.load();
+		const unsigned long long bytesBefore = g_allocBytes.load();
+		for (int i = 0; i < options.reps; ++i)
+		{
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			work = runOnce(asset, options);
+			times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		const unsigned long long allocs = (g_allocCount.load() - allocsBefore) / static_cast<unsigned long long>(options.reps);
+		const unsigned long long allocBytes = (g_allocBytes.load() - bytesBefore) / static_cast<unsigned long long>(options.reps);
+		std::cout.rdbuf(console);
+
+		std::sort(times.begin(), times.end());
+		double mean = 0.0;
+		for (std::size_t i = 0; i < times.size(); ++i)
+			mean += times[i];
+		mean /= static_cast<double>(times.size());
+		const double median = (times.size() % 2) ? times[times.size() / 2]
+			: 0.5 * (times[times.size() / 2 - 1] + times[times.size() / 2]);
+		const double seconds = median > 0.0 ? median / 1000.0 : 1e-9;
+
+		std::printf("%s\n    {\"path\": %s, \"kind\": \"%s\", \"ok\": %s, \"bytes\": %zu,\n"
+			"     \"ms\": {\"min\": %.3f, \"median\": %.3f, \"mean\": %.3f, \"max\": %.3f},\n"
+			"     \"mb_per_s\": %.2f",
+			a == 0 ? "" : ",", quoted(asset.path).c_str(), kindName(asset.kind), work.ok ? "true" : "false",
+			asset.bytes, times.front(), median, mean, times.back(),
+			static_cast<double>(asset.bytes) / (1024.0 * 1024.0) / seconds);
+		if (asset.kind == KIND_OBJ)
+			std::printf(", \"vertices\": %zu, \"faces\": %zu, \"vertices_per_s\": %.0f, \"faces_per_s\": %.0f",
+				work.vertices, work.faces, static_cast<double>(work.vertices) / seconds,
+				static_cast<double>(work.faces) / seconds);
+		if (asset.kind == KIND_OBJ)
+			std::printf(",\n     \"parse_ms\": %.3f, \"normals_ms\": %.3f, \"peak_heap_kb\": %zu",
+				work.stats.parseMs, work.stats.normalsMs, work.stats.peakHeapBytes / 1024);
+		if (asset.kind == KIND_OBJ && options.seam)
+		{
+			std::size_t shared = 0, split = 0;
+			std::cout.rdbuf(&silence);
+			const bool checked = checkSeam(asset, options, shared, split);
+			std::cout.rdbuf(console);
+			std::printf(", \"seam_positions\": %zu, \"seam_split\": %zu", shared, split);
+			if (!checked || split > 0)
+				seamSplit = true;
+		}
+		if (asset.kind != KIND_PPM)
+			std::printf(", \"materials\": %zu", work.materials);
+		else
+			std::printf(", \"pixels\": %zu, \"pixels_per_s\": %.0f", work.pixels,
+				static_cast<double>(work.pixels) / seconds);
+		std::printf(",\n     \"allocations\": %llu, \"allocated_bytes\": %llu, \"peak_rss_kb\": %ld, \"peak_rss_reset\": %s}",
+			allocs, allocBytes, peakRssKb(), peakReset ? "true" : "false");
+		std::fflush(stdout);
+	}
+	std::printf("\n  ]\n}\n");
+	return seamSplit ? 1 : 0;
+}
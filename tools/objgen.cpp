@@ -0,0 +1,550 @@
+// Generateur de fichiers OBJ / MTL / PPM synthetiques, pour charger et afficher
+// de gros modeles sans donnees client.
+//
+//   scop_objgen [options]
+//
+//   --out BASE        fichiers ecrits : BASE.obj, BASE.mtl, BASE_<n>.ppm (defaut synthetic)
+//   --triangles N     s'arrete apres N triangles (apres triangulation ; defaut 1M,
+//                     suffixes K, M, G en puissances de 1000)
+//   --size N          s'arrete quand BASE.obj atteint N octets (K, M, G : puissances de 1024)
+//   --format F        coins de face : v, v/vt, v//vn ou v/vt/vn (defaut v/vt/vn)
+//   --poly N          coins par face : 3 triangles, 4 quads, 5 et plus n-gones (defaut 3)
+//   --negative        index relatifs negatifs (-1 : dernier vertex ecrit)
+//   --groups N        groupes "g" parcourus a tour de role (defaut 1, 0 : aucun)
+//   --materials N     materiaux "usemtl" parcourus a tour de role, avec un .mtl (defaut 0)
+//   --texture WxH     une texture PPM (P3) par materiau (defaut aucune)
+//   --patch N         cote d'une plaque en cellules (defaut 256)
+//   --seed N          graine du relief (defaut 1)
+//
+// Le modele est une suite de plaques carrees de patch x patch cellules, posees
+// sur une grille ; chaque plaque change de groupe et de materiau. Les vertices
+// sont ecrits ligne par ligne juste avant les faces qui les utilisent, ce qui
+// garde les index negatifs petits et permet de s'arreter a n'importe quelle ligne.
+// Une cellule donne deux triangles, un quad, ou un n-gone convexe (les coins en
+// plus sont sur son bord haut, propres a la cellule). Chaque vertex a ses vt et
+// vn au meme index que sa position.
+//
+// Memes options, memes octets : le relief vient d'un hachage entier, les nombres
+// sont ecrits en virgule fixe (6 decimales) sans passer par printf.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	enum Format
+	{
+		FORMAT_V,
+		FORMAT_V_VT,
+		FORMAT_V_VN,
+		FORMAT_V_VT_VN
+	};
+
+	struct Options
+	{
+		std::string out{"synthetic"};
+		unsigned long long triangles{1000000};
+		unsigned long long size{0}; // 0 : pas de limite de taille
+		Format format{FORMAT_V_VT_VN};
+		int poly{3};
+		bool negative{false};
+		int groups{1};
+		int materials{0};
+		int textureWidth{0};
+		int textureHeight{0};
+		int patch{256};
+		unsigned seed{1};
+	};
+
+	// Tampon de sortie : tout passe par append*, vide par gros blocs
+	class Writer
+	{
+		public:
+			Writer() : m_file(NULL), m_written(0) { m_buffer.reserve(kFlushBytes + 256); }
+			~Writer() { close(); }
+
+			bool open(const std::string& path)
+			{
+				m_file = std::fopen(path.c_str(), "wb");
+				if (m_file == NULL)
+					std::cerr << "objgen: impossible d'ecrire " << path << "\n";
+				return m_file != NULL;
+			}
+
+			bool close()
+			{
+				if (m_file == NULL)
+					return true;
+				flush();
+				const bool ok = std::ferror(m_file) == 0;
+				std::fclose(m_file);
+				m_file = NULL;
+				return ok;
+			}
+
+			unsigned long long written() const { return m_written + m_buffer.size(); }
+
+			void append(const char* s) { m_buffer.append(s); maybeFlush(); }
+			void append(char c) { m_buffer.push_back(c); }
+
+			void appendInt(long long value)
+			{
+				char digits[24];
+				int n = 0;
+				const bool negative = value < 0;
+				unsigned long long u = negative ? 0ull - static_cast<unsigned long long>(value)
+					: static_cast<unsigned long long>(value);
+				do
+				{
+					digits[n++] = static_cast<char>('0' + u % 10);
+					u /= 10;
+				} while (u != 0);
+				if (negative)
+					m_buffer.push_back('-');
+				while (n > 0)
+					m_buffer.push_back(digits[--n]);
+			}
+
+			// Virgule fixe, 6 decimales ; value en millioniemes
+			void appendFixed(long long micro)
+			{
+				if (micro < 0)
+				{
+					m_buffer.push_back('-');
+					micro = -micro;
+				}
+				appendInt(micro / 1000000);
+				m_buffer.push_back('.');
+				long long frac = micro % 1000000;
+				char digits[6];
+				for (int i = 5; i >= 0; --i)
+				{
+					digits[i] = static_cast<char>('0' + frac % 10);
+					frac /= 10;
+				}
+				m_buffer.append(digits, 6);
+			}
+
+			void endLine() { m_buffer.push_back('\n'); maybeFlush(); }
+
+		private:
+			static const std::size_t kFlushBytes = 1 << 20;
+
+			void maybeFlush()
+			{
+				if (m_buffer.size() >= kFlushBytes)
+					flush();
+			}
+
+			void flush()
+			{
+				if (m_file != NULL && !m_buffer.empty())
+					std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_file);
+				m_written += m_buffer.size();
+				m_buffer.clear();
+			}
+
+		private:
+			std::FILE* m_file;
+			std::string m_buffer;
+			unsigned long long m_written;
+	};
+
+	// Hachage entier (fin de splitmix64) : meme relief sur toutes les machines
+	unsigned long long mix(unsigned long long x)
+	{
+		x += 0x9e3779b97f4a7c15ull;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	std::string baseName(const std::string& path)
+	{
+		const std::string::size_type slash = path.find_last_of('/');
+		return slash == std::string::npos ? path : path.substr(slash + 1);
+	}
+
+	std::string texturePath(const Options& options, int material)
+	{
+		char suffix[32];
+		std::snprintf(suffix, sizeof(suffix), "_%d.ppm", material);
+		return options.out + suffix;
+	}
+
+	// Couleur d'un materiau en millioniemes, par composante
+	long long materialColor(int material, int component)
+	{
+		return static_cast<long long>(200000 + mix(static_cast<unsigned long long>(material) * 3 + component) % 800001);
+	}
+
+	// Nombre avec suffixe K, M ou G : puissances de unit (1000 ou 1024)
+	bool parseCount(const char* text, double unit, unsigned long long& out)
+	{
+		char* end = NULL;
+		const double value = std::strtod(text, &end);
+		if (end == text || value < 0.0)
+			return false;
+		double scale = 1.0;
+		if (*end == 'K' || *end == 'k')
+			scale = unit;
+		else if (*end == 'M' || *end == 'm')
+			scale = unit * unit;
+		else if (*end == 'G' || *end == 'g')
+			scale = unit * unit * unit;
+		else if (*end != '\0')
+			return false;
+		out = static_cast<unsigned long long>(value * scale);
+		return true;
+	}
+
+	void usage()
+	{
+		std::cerr << "usage: scop_objgen [--out BASE] [--triangles N] [--size N[K|M|G]]\n"
+			"                   [--format v|v/vt|v//vn|v/vt/vn] [--poly N] [--negative]\n"
+			"                   [--groups N] [--materials N] [--texture WxH] [--patch N] [--seed N]\n";
+	}
+
+	bool parseOptions(int argc, char** argv, Options& options)
+	{
+		bool triangleLimit = false;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+			if (arg == "--help" || arg == "-h")
+				return false;
+			if (arg == "--negative")
+			{
+				options.negative = true;
+				continue;
+			}
+			if (value == NULL)
+			{
+				std::cerr << "objgen: valeur manquante pour " << arg << "\n";
+				return false;
+			}
+			++i;
+			bool ok = true;
+			if (arg == "--out")
+				options.out = value;
+			else if (arg == "--triangles")
+			{
+				ok = parseCount(value, 1000.0, options.triangles);
+				triangleLimit = true;
+			}
+			else if (arg == "--size")
+				ok = parseCount(value, 1024.0, options.size);
+			else if (arg == "--format")
+			{
+				const std::string f = value;
+				if (f == "v")
+					options.format = FORMAT_V;
+				else if (f == "v/vt")
+					options.format = FORMAT_V_VT;
+				else if (f == "v//vn")
+					options.format = FORMAT_V_VN;
+				else if (f == "v/vt/vn")
+					options.format = FORMAT_V_VT_VN;
+				else
+					ok = false;
+			}
+			else if (arg == "--poly")
+				ok = (options.poly = std::atoi(value)) >= 3;
+			else if (arg == "--groups")
+				ok = (options.groups = std::atoi(value)) >= 0;
+			else if (arg == "--materials")
+				ok = (options.materials = std::atoi(value)) >= 0;
+			else if (arg == "--texture")
+				ok = std::sscanf(value, "%dx%d", &options.textureWidth, &options.textureHeight) == 2
+					&& options.textureWidth > 0 && options.textureHeight > 0;
+			else if (arg == "--patch")
+				ok = (options.patch = std::atoi(value)) >= 1;
+			else if (arg == "--seed")
+				options.seed = static_cast<unsigned>(std::strtoul(value, NULL, 10));
+			else
+			{
+				std::cerr << "objgen: option inconnue : " << arg << "\n";
+				return false;
+			}
+			if (!ok)
+			{
+				std::cerr << "objgen: valeur invalide pour " << arg << " : " << value << "\n";
+				return false;
+			}
+		}
+		// --size seul : la taille decide, pas le nombre de triangles par defaut
+		if (options.size > 0 && !triangleLimit)
+			options.triangles = 0;
+		if (options.textureWidth > 0 && options.materials == 0)
+			std::cerr << "objgen: --texture sans --materials : aucune texture ecrite\n";
+		return true;
+	}
+
+	// Generation du .obj, ligne de cellules par ligne de cellules
+	class ObjWriter
+	{
+		public:
+			ObjWriter(const Options& options, Writer& out)
+				: m_options(options)
+				, m_out(out)
+				, m_vertexCount(0)
+				, m_faceCount(0)
+				, m_triangleCount(0)
+			{
+			}
+
+			unsigned long long vertexCount() const { return m_vertexCount; }
+			unsigned long long faceCount() const { return m_faceCount; }
+			unsigned long long triangleCount() const { return m_triangleCount; }
+
+			void run()
+			{
+				m_out.append("# scop_objgen\n");
+				if (m_options.materials > 0)
+				{
+					m_out.append("mtllib ");
+					m_out.append(baseName(m_options.out + ".mtl").c_str());
+					m_out.endLine();
+				}
+				for (unsigned long long patch = 0; !done(); ++patch)
+					writePatch(patch);
+			}
+
+		private:
+			bool done() const
+			{
+				if (m_options.triangles > 0 && m_triangleCount >= m_options.triangles)
+					return true;
+				return m_options.size > 0 && m_out.written() >= m_options.size;
+			}
+
+			// Ecrit v (et vt, vn selon le format) ; uv et position en millioniemes
+			void writeVertex(long long x, long long y, long long u, long long v)
+			{
+				const long long z = static_cast<long long>(mix(m_vertexCount ^ (static_cast<unsigned long long>(m_options.seed) << 40)) % 20001) - 10000;
+				m_out.append("v ");
+				m_out.appendFixed(x);
+				m_out.append(' ');
+				m_out.appendFixed(y);
+				m_out.append(' ');
+				m_out.appendFixed(z);
+				m_out.endLine();
+				if (m_options.format == FORMAT_V_VT || m_options.format == FORMAT_V_VT_VN)
+				{
+					m_out.append("vt ");
+					m_out.appendFixed(u);
+					m_out.append(' ');
+					m_out.appendFixed(v);
+					m_out.endLine();
+				}
+				if (m_options.format == FORMAT_V_VN || m_options.format == FORMAT_V_VT_VN)
+					m_out.append("vn 0.000000 0.000000 1.000000\n");
+				++m_vertexCount;
+			}
+
+			// Coin de face ; vertex est un index 0-based
+			void writeCorner(unsigned long long vertex)
+			{
+				const long long index = m_options.negative
+					? static_cast<long long>(vertex) - static_cast<long long>(m_vertexCount)
+					: static_cast<long long>(vertex) + 1;
+				m_out.append(' ');
+				m_out.appendInt(index);
+				if (m_options.format == FORMAT_V)
+					return;
+				m_out.append('/');
+				if (m_options.format != FORMAT_V_VN)
+					m_out.appendInt(index);
+				if (m_options.format == FORMAT_V_VT)
+					return;
+				m_out.append('/');
+				m_out.appendInt(index);
+			}
+
+			void writeFace(const unsigned long long* corners, int count)
+			{
+				m_out.append('f');
+				for (int k = 0; k < count; ++k)
+					writeCorner(corners[k]);
+				m_out.endLine();
+				++m_faceCount;
+				m_triangleCount += static_cast<unsigned long long>(count - 2);
+			}
+
+			void writePatch(unsigned long long patch)
+			{
+				const int cells = m_options.patch;
+				const int extras = m_options.poly > 4 ? m_options.poly - 4 : 0; // coins en plus d'un n-gone
+				const long long cellSize = 1000000 / cells;
+				// 16 plaques par rangee, espacees d'un dixieme de plaque
+				const long long originX = static_cast<long long>(patch % 16) * (cells * cellSize * 11 / 10);
+				const long long originY = static_cast<long long>(patch / 16) * (cells * cellSize * 11 / 10);
+
+				if (m_options.groups > 0)
+				{
+					m_out.append("g group_");
+					m_out.appendInt(static_cast<long long>(patch % static_cast<unsigned long long>(m_options.groups)));
+					m_out.endLine();
+				}
+				if (m_options.materials > 0)
+				{
+					m_out.append("usemtl material_");
+					m_out.appendInt(static_cast<long long>(patch % static_cast<unsigned long long>(m_options.materials)));
+					m_out.endLine();
+				}
+
+				unsigned long long below = m_vertexCount;
+				for (int i = 0; i <= cells; ++i)
+					writeVertex(originX + i * cellSize, originY, 1000000LL * i / cells, 0);
+
+				std::vector<unsigned long long> corners(static_cast<std::size_t>(4 + extras));
+				for (int row = 0; row < cells && !done(); ++row)
+				{
+					const long long y = originY + (row + 1) * cellSize;
+					const long long v = 1000000LL * (row + 1) / cells;
+					const unsigned long long above = m_vertexCount;
+					for (int i = 0; i <= cells; ++i)
+						writeVertex(originX + i * cellSize, y, 1000000LL * i / cells, v);
+					// Coins en plus des n-gones : sur le bord haut de chaque cellule, de droite a gauche
+					const unsigned long long extraBase = m_vertexCount;
+					for (int i = 0; i < cells; ++i)
+						for (int e = 1; e <= extras; ++e)
+						{
+							const long long t = 1000000LL - 1000000LL * e / (extras + 1);
+							writeVertex(originX + i * cellSize + cellSize * t / 1000000, y,
+								(1000000LL * i + t) / cells, v);
+						}
+
+					for (int i = 0; i < cells; ++i)
+					{
+						const unsigned long long bl = below + i, br = below + i + 1;
+						const unsigned long long tl = above + i, tr = above + i + 1;
+						if (m_options.poly == 3)
+						{
+							corners[0] = bl; corners[1] = br; corners[2] = tr;
+							writeFace(corners.data(), 3);
+							corners[0] = bl; corners[1] = tr; corners[2] = tl;
+							writeFace(corners.data(), 3);
+							continue;
+						}
+						int n = 0;
+						corners[n++] = bl;
+						corners[n++] = br;
+						corners[n++] = tr;
+						for (int e = 0; e < extras; ++e)
+							corners[n++] = extraBase + static_cast<unsigned long long>(i) * extras + e;
+						corners[n++] = tl;
+						writeFace(corners.data(), n);
+					}
+					below = above;
+				}
+			}
+
+		private:
+			const Options& m_options;
+			Writer& m_out;
+			unsigned long long m_vertexCount;
+			unsigned long long m_faceCount;
+			unsigned long long m_triangleCount;
+	};
+
+	bool writeMtl(const Options& options)
+	{
+		Writer out;
+		if (!out.open(options.out + ".mtl"))
+			return false;
+		out.append("# scop_objgen\n");
+		for (int m = 0; m < options.materials; ++m)
+		{
+			out.append("newmtl material_");
+			out.appendInt(m);
+			out.endLine();
+			out.append("Ka 0.100000 0.100000 0.100000\nKd");
+			for (int c = 0; c < 3; ++c)
+			{
+				out.append(' ');
+				out.appendFixed(materialColor(m, c));
+			}
+			out.endLine();
+			out.append("Ks 0.200000 0.200000 0.200000\nNs 32.000000\nd 1.000000\nillum 2\n");
+			if (options.textureWidth > 0)
+			{
+				out.append("map_Kd ");
+				out.append(baseName(texturePath(options, m)).c_str());
+				out.endLine();
+			}
+			out.endLine();
+		}
+		return out.close();
+	}
+
+	// Damier 8x8 cases : couleur du materiau et sa moitie
+	bool writeTexture(const Options& options, int material)
+	{
+		Writer out;
+		if (!out.open(texturePath(options, material)))
+			return false;
+		out.append("P3\n");
+		out.appendInt(options.textureWidth);
+		out.append(' ');
+		out.appendInt(options.textureHeight);
+		out.append("\n255\n");
+		int color[3];
+		for (int c = 0; c < 3; ++c)
+			color[c] = static_cast<int>(materialColor(material, c) * 255 / 1000000);
+		for (int y = 0; y < options.textureHeight; ++y)
+		{
+			for (int x = 0; x < options.textureWidth; ++x)
+			{
+				const bool dark = ((x * 8 / options.textureWidth) + (y * 8 / options.textureHeight)) % 2 != 0;
+				for (int c = 0; c < 3; ++c)
+				{
+					if (x > 0 || c > 0)
+						out.append(' ');
+					out.appendInt(dark ? color[c] / 2 : color[c]);
+				}
+			}
+			out.endLine();
+		}
+		return out.close();
+	}
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		usage();
+		return 2;
+	}
+
+	Writer obj;
+	if (!obj.open(options.out + ".obj"))
+		return 1;
+	ObjWriter generator(options, obj);
+	generator.run();
+	const unsigned long long objBytes = obj.written();
+	if (!obj.close())
+	{
+		std::cerr << "objgen: erreur d'ecriture de " << options.out << ".obj\n";
+		return 1;
+	}
+
+	if (options.materials > 0 && !writeMtl(options))
+		return 1;
+	if (options.textureWidth > 0)
+		for (int m = 0; m < options.materials; ++m)
+			if (!writeTexture(options, m))
+				return 1;
+
+	std::cerr << "objgen: " << options.out << ".obj : " << generator.vertexCount() << " vertices, "
+		<< generator.faceCount() << " faces, " << generator.triangleCount() << " triangles, "
+		<< objBytes << " octets\n";
+	return 0;
+}